@@ -0,0 +1,49 @@
+#ifndef ARRAY_UTILS_H
+#define ARRAY_UTILS_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+
+namespace nb = nanobind;
+
+// read-only inputs shared by the tracking kernels
+using IndexPairs = nb::ndarray<const int, nb::shape<-1, 2>, nb::c_contig>;
+using Values = nb::ndarray<const float, nb::shape<-1>, nb::c_contig>;
+
+/**
+ * Moves a vector into a numpy array of the given shape without copying.
+ * The array owns the buffer and frees it once Python releases it.
+ */
+template <typename T>
+nb::ndarray<nb::numpy, T> to_ndarray(
+    std::vector<T> &&values,
+    std::initializer_list<size_t> shape
+) {
+    std::vector<T> *owned = new std::vector<T>(std::move(values));
+    nb::capsule owner(owned, [](void *p) noexcept {
+        delete (std::vector<T> *) p;
+    });
+    return nb::ndarray<nb::numpy, T>(owned->data(), shape.size(), shape.begin(), owner);
+}
+
+/**
+ * Same as to_ndarray for boolean arrays, which are stored as bytes
+ * because std::vector<bool> is bit-packed.
+ */
+inline nb::ndarray<nb::numpy, bool> to_bool_ndarray(
+    std::vector<uint8_t> &&values,
+    std::initializer_list<size_t> shape
+) {
+    std::vector<uint8_t> *owned = new std::vector<uint8_t>(std::move(values));
+    nb::capsule owner(owned, [](void *p) noexcept {
+        delete (std::vector<uint8_t> *) p;
+    });
+    return nb::ndarray<nb::numpy, bool>(
+        reinterpret_cast<bool *>(owned->data()), shape.size(), shape.begin(), owner
+    );
+}
+
+#endif // ARRAY_UTILS_H
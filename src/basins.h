@@ -0,0 +1,125 @@
+#ifndef BASINS_H
+#define BASINS_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// basin labels of voxels outside the current component and not yet flooded
+enum : int { OUTSIDE = -2, UNFLOODED = -1 };
+
+/**
+ * Oversegmentation of a connected component into basins and the region
+ * adjacency graph (RAG) between them.
+ *
+ * A basin is a maximal set of voxels joined by edges of at most
+ * `threshold`. With threshold = min_frontier no hypothesis can be emitted
+ * inside a basin, so joining basins first and running Kruskal over the
+ * RAG gives the hypotheses of the full face-adjacency graph, while the
+ * edge stage only sorts one edge per pair of adjacent basins.
+ */
+struct Basins {
+    std::vector<int> voxels;  // component voxels, grouped by basin
+    std::vector<int> ranges;  // [start, end) of each basin in voxels, flattened
+    std::vector<int> edges;   // lowest edge (u, v) between each pair of adjacent basins, flattened
+};
+
+
+/**
+ * Floods the basins of the component `visited` in order of discovery and
+ * keeps the lowest edge between every pair of adjacent basins.
+ *
+ * `basin_of` is a volume of labels shared by all components, OUTSIDE
+ * everywhere on entry and on return, so labels are dense lookups and only
+ * the component voxels are touched.
+ * Each face between two basins is found once, from the voxel of the later
+ * basin, when the other side is already labeled.
+ * Time complexity: O(n) expected, with n the component size
+ */
+template <typename EdgeWeight>
+Basins find_basins(
+    const std::vector<int> &visited,
+    const EdgeWeight &weight,
+    float threshold,
+    int depth,
+    int height,
+    int width,
+    std::vector<int> &basin_of
+) {
+    Basins basins;
+    basins.voxels.reserve(visited.size());
+    for (int idx : visited) {
+        basin_of[idx] = UNFLOODED;
+    }
+
+    // edges are compared by their sort keys, so the lowest one is the
+    // first the voxel-level Kruskal would merge
+    std::unordered_map<uint64_t, size_t> lowest;  // basin pair -> edge in basins.edges
+    std::vector<typename EdgeWeight::key_type> lowest_key;
+    std::vector<int> stack;
+    int plane = height * width;
+
+    for (int seed : visited) {
+        if (basin_of[seed] != UNFLOODED) {
+            continue;
+        }
+        int basin = static_cast<int>(basins.ranges.size() / 2);
+        basin_of[seed] = basin;
+        basins.ranges.push_back(static_cast<int>(basins.voxels.size()));
+        stack.push_back(seed);
+
+        while (!stack.empty()) {
+            int idx = stack.back();
+            stack.pop_back();
+            basins.voxels.push_back(idx);
+
+            int z = idx / plane;
+            int y = (idx % plane) / width;
+            int x = idx % width;
+            int neighbors[6];
+            int num_neighbors = 0;
+            if (z > 0) neighbors[num_neighbors++] = idx - plane;
+            if (z < depth - 1) neighbors[num_neighbors++] = idx + plane;
+            if (y > 0) neighbors[num_neighbors++] = idx - width;
+            if (y < height - 1) neighbors[num_neighbors++] = idx + width;
+            if (x > 0) neighbors[num_neighbors++] = idx - 1;
+            if (x < width - 1) neighbors[num_neighbors++] = idx + 1;
+
+            for (int i = 0; i < num_neighbors; i++) {
+                int nidx = neighbors[i];
+                int other = basin_of[nidx];
+                if (other == OUTSIDE || other == basin) {
+                    continue;
+                }
+                if (other == UNFLOODED) {
+                    if (weight(idx, nidx) <= threshold) {
+                        basin_of[nidx] = basin;
+                        stack.push_back(nidx);
+                    }
+                    continue;
+                }
+
+                auto key = weight.key(idx, nidx);
+                uint64_t pair = static_cast<uint64_t>(other) << 32 | static_cast<uint32_t>(basin);
+                auto [entry, inserted] = lowest.try_emplace(pair, lowest_key.size());
+                if (inserted) {
+                    basins.edges.push_back(idx);
+                    basins.edges.push_back(nidx);
+                    lowest_key.push_back(key);
+                } else if (key < lowest_key[entry->second]) {
+                    basins.edges[2 * entry->second] = idx;
+                    basins.edges[2 * entry->second + 1] = nidx;
+                    lowest_key[entry->second] = key;
+                }
+            }
+        }
+        basins.ranges.push_back(static_cast<int>(basins.voxels.size()));
+    }
+
+    for (int idx : visited) {
+        basin_of[idx] = OUTSIDE;
+    }
+    return basins;
+}
+
+#endif // BASINS_H
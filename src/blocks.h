@@ -0,0 +1,110 @@
+#ifndef BLOCKS_H
+#define BLOCKS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "parallel.h"
+
+/**
+ * Coarse grid of cubic blocks used by the multi-resolution mode.
+ *
+ * A coarse pass marks the smooth blocks, whose internal edges all weigh at
+ * most min_frontier, so no hypothesis can ever be emitted by them. The
+ * search tree edges inside those blocks are merged first, in search order,
+ * and only the remaining edges are sorted.
+ */
+struct BlockGrid {
+    enum State : uint8_t {
+        PLAIN = 0,   // internal edges are sorted with the others
+        SMOOTH = 1,  // internal edges all weigh at most the threshold
+    };
+
+    int factor;      // block edge in voxels
+    int depth;       // volume size in voxels
+    int height;
+    int width;
+    int blocks_z;    // grid size in blocks
+    int blocks_y;
+    int blocks_x;
+    std::vector<uint8_t> state;
+
+    BlockGrid(int factor, int depth, int height, int width)
+        : factor(factor), depth(depth), height(height), width(width),
+          blocks_z((depth + factor - 1) / factor),
+          blocks_y((height + factor - 1) / factor),
+          blocks_x((width + factor - 1) / factor),
+          state(static_cast<size_t>(blocks_z) * blocks_y * blocks_x, PLAIN) {}
+
+    int block_of(int idx) const {
+        int z = idx / (height * width);
+        int y = (idx / width) % height;
+        int x = idx % width;
+        return ((z / factor) * blocks_y + y / factor) * blocks_x + x / factor;
+    }
+
+    /**
+     * Whether the edge (u, v) lies inside a smooth block.
+     */
+    bool is_smooth_edge(int u, int v) const {
+        int block = block_of(u);
+        return state[block] == SMOOTH && block_of(v) == block;
+    }
+
+    /**
+     * Calls f(idx) on the voxels of a block in scan order; blocks on the
+     * upper borders are clipped to the volume.
+     */
+    template <typename F>
+    void for_each_voxel(int block, F &&f) const {
+        int bz = block / (blocks_y * blocks_x);
+        int by = (block / blocks_x) % blocks_y;
+        int bx = block % blocks_x;
+        int z1 = std::min(depth, (bz + 1) * factor);
+        int y1 = std::min(height, (by + 1) * factor);
+        int x1 = std::min(width, (bx + 1) * factor);
+        for (int z = bz * factor; z < z1; z++) {
+            for (int y = by * factor; y < y1; y++) {
+                for (int x = bx * factor; x < x1; x++) {
+                    f((z * height + y) * width + x);
+                }
+            }
+        }
+    }
+};
+
+
+/**
+ * Coarse pass: marks the blocks whose internal edges all weigh at most
+ * `threshold`, in parallel over slabs of blocks.
+ * Time complexity: O(voxels), without sorting
+ */
+template <typename EdgeWeight>
+void mark_smooth_blocks(BlockGrid &grid, const EdgeWeight &weight, float threshold, int num_threads) {
+    int plane = grid.height * grid.width;
+    int blocks_per_slab = grid.blocks_y * grid.blocks_x;
+    parallel_for(grid.blocks_z, [&](size_t bz) {
+        for (int b = 0; b < blocks_per_slab; b++) {
+            int block = static_cast<int>(bz) * blocks_per_slab + b;
+            bool smooth = true;
+            grid.for_each_voxel(block, [&](int idx) {
+                int z = idx / plane;
+                int y = (idx / grid.width) % grid.height;
+                int x = idx % grid.width;
+                // forward edges that stay inside the block
+                if ((z + 1) % grid.factor != 0 && z + 1 < grid.depth) {
+                    smooth &= weight(idx, idx + plane) <= threshold;
+                }
+                if ((y + 1) % grid.factor != 0 && y + 1 < grid.height) {
+                    smooth &= weight(idx, idx + grid.width) <= threshold;
+                }
+                if ((x + 1) % grid.factor != 0 && x + 1 < grid.width) {
+                    smooth &= weight(idx, idx + 1) <= threshold;
+                }
+            });
+            grid.state[block] = smooth ? BlockGrid::SMOOTH : BlockGrid::PLAIN;
+        }
+    }, num_threads);
+}
+
+#endif // BLOCKS_H
@@ -0,0 +1,363 @@
+#ifndef COMPONENT_TREE_H
+#define COMPONENT_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "edge_keys.h"
+#include "flood.h"
+#include "hierarchy.h"
+#include "parallel.h"
+
+/**
+ * Volumes shared by the min-trees of all components. `state` is
+ * NOT_MEMBER everywhere between components; the others are only read at
+ * the voxels of the current component.
+ */
+struct TreeScratch {
+    std::vector<int> parent;     // min-tree parent of each voxel
+    std::vector<int> work;       // union-find roots while building, child counts while replaying
+    std::vector<uint8_t> state;
+
+    explicit TreeScratch(size_t size) : parent(size), work(size), state(size, NOT_MEMBER) {}
+};
+
+
+/**
+ * Min-tree of the voxel keys of a connected component, as parent pointers
+ * in the style of Najman and Couprie: every voxel points to a voxel of its
+ * node or of the parent node, and the canonical voxel of a node, the only
+ * one whose parent has another key or is itself, identifies the node.
+ *
+ * The component is cut into z-slabs holding similar numbers of voxels.
+ * Each slab builds its own tree in parallel by union-find by level
+ * (Berger et al.), then trees are merged pairwise along the planes between
+ * slabs in log2(slabs) parallel rounds (Wilkinson et al.), each round
+ * touching disjoint groups of slabs. The tree is unique and its canonical
+ * voxels are normalized, so the pointers do not depend on the slabs.
+ */
+template <typename EdgeWeight>
+class MinTreeBuilder {
+private:
+    using Key = typename EdgeWeight::key_type;
+
+    const std::vector<int> &visited;
+    const EdgeWeight &weight;
+    int depth;
+    int height;
+    int width;
+    TreeScratch &scratch;
+
+public:
+    MinTreeBuilder(
+        const std::vector<int> &visited,
+        const EdgeWeight &weight,
+        int depth,
+        int height,
+        int width,
+        TreeScratch &scratch
+    ) : visited(visited), weight(weight), depth(depth), height(height), width(width), scratch(scratch) {}
+
+    /**
+     * Builds the canonical min-tree of the component into scratch.parent
+     * and leaves its voxels MEMBER in scratch.state.
+     * A single slab is built directly, so small components never pay for
+     * the per-plane tables of the slab cut.
+     * Time complexity: O(n log n / slabs) per slab, plus the chains walked
+     * along the slab boundaries
+     */
+    void build(int num_slabs, int num_threads) {
+        int plane = height * width;
+        std::vector<int> &parent = scratch.parent;
+        std::vector<uint8_t> &state = scratch.state;
+
+        if (num_slabs <= 1) {
+            build_slab(visited, 0, depth);
+            for (int idx : visited) {
+                parent[idx] = level_root(parent[idx]);
+            }
+            normalize();
+            return;
+        }
+
+        // cut the z-range into slabs of similar voxel counts
+        std::vector<size_t> per_plane(depth, 0);
+        for (int idx : visited) {
+            state[idx] = MEMBER;
+            per_plane[idx / plane]++;
+        }
+        std::vector<int> cuts = {0};  // first plane of each slab
+        size_t accumulated = 0;
+        for (int z = 0; z < depth; z++) {
+            size_t target = visited.size() * cuts.size() / num_slabs;
+            if (accumulated >= target && accumulated > 0 && static_cast<int>(cuts.size()) < num_slabs) {
+                cuts.push_back(z);
+            }
+            accumulated += per_plane[z];
+        }
+        cuts.push_back(depth);
+        int slabs = static_cast<int>(cuts.size()) - 1;
+
+        // voxels of each slab, and faces crossing the plane below each slab
+        std::vector<std::vector<int>> slab_voxels(slabs);
+        std::vector<std::vector<int>> crossings(slabs);
+        std::vector<int> slab_of(depth);
+        for (int s = 0; s < slabs; s++) {
+            std::fill(slab_of.begin() + cuts[s], slab_of.begin() + cuts[s + 1], s);
+        }
+        for (int idx : visited) {
+            int z = idx / plane;
+            int s = slab_of[z];
+            slab_voxels[s].push_back(idx);
+            if (s > 0 && z == cuts[s] && state[idx - plane] == MEMBER) {
+                crossings[s].push_back(idx);
+            }
+        }
+
+        parallel_for(slabs, [&](size_t s) {
+            build_slab(slab_voxels[s], cuts[s], cuts[s + 1]);
+        }, num_threads);
+
+        for (int stride = 1; stride < slabs; stride *= 2) {
+            size_t num_pairs = (slabs + 2 * stride - 1) / (2 * stride);
+            parallel_for(num_pairs, [&](size_t pair) {
+                int upper = static_cast<int>(pair) * 2 * stride + stride;
+                if (upper >= slabs) {
+                    return;
+                }
+                for (int idx : crossings[upper]) {
+                    connect(idx - plane, idx);
+                }
+            }, num_threads);
+        }
+
+        for (int idx : visited) {
+            parent[idx] = level_root(parent[idx]);
+        }
+        normalize();
+    }
+
+private:
+    Key key(int idx) const {
+        return weight.vertex_key(idx);
+    }
+
+    /**
+     * Canonical voxel of the node of idx.
+     */
+    int level_root(int idx) {
+        std::vector<int> &parent = scratch.parent;
+        int root = idx;
+        while (parent[root] != root && key(parent[root]) == key(root)) {
+            root = parent[root];
+        }
+        while (parent[idx] != root && key(parent[idx]) == key(root)) {
+            int next = parent[idx];
+            parent[idx] = root;
+            idx = next;
+        }
+        return root;
+    }
+
+    /**
+     * Canonical voxel of the node of idx, once pointers are canonical.
+     */
+    int node_of(int idx) const {
+        int up = scratch.parent[idx];
+        return up == idx || key(up) != key(idx) ? idx : up;
+    }
+
+    /**
+     * Makes the first voxel of each node in `visited` order its canonical
+     * voxel, so pointers do not depend on how the slabs were merged.
+     */
+    void normalize() {
+        std::vector<int> &parent = scratch.parent;
+        std::vector<int> &first = scratch.work;  // by old canonical voxel
+
+        for (int idx : visited) {
+            first[idx] = -1;
+        }
+        for (int idx : visited) {
+            int node = node_of(idx);
+            if (first[node] < 0) {
+                first[node] = idx;
+            }
+        }
+
+        std::vector<int> normalized(visited.size());
+        for (size_t i = 0; i < visited.size(); i++) {
+            int idx = visited[i];
+            int node = node_of(idx);
+            if (idx != first[node]) {
+                normalized[i] = first[node];
+            } else {
+                normalized[i] = parent[node] == node ? idx : first[parent[node]];
+            }
+        }
+        for (size_t i = 0; i < visited.size(); i++) {
+            parent[visited[i]] = normalized[i];
+        }
+    }
+
+    /**
+     * Union-find by level over the voxels of one slab, planes [z0, z1):
+     * voxels are visited in increasing key order and become the parent of
+     * the roots of their visited neighbors, then pointers are canonicalized
+     * from the root down.
+     */
+    void build_slab(const std::vector<int> &voxels, int z0, int z1) {
+        std::vector<int> &parent = scratch.parent;
+        std::vector<int> &zpar = scratch.work;
+        std::vector<uint8_t> &state = scratch.state;
+        int plane = height * width;
+
+        std::vector<Key> keys(voxels.size());
+        for (size_t i = 0; i < voxels.size(); i++) {
+            keys[i] = key(voxels[i]);
+        }
+        std::vector<uint32_t> order = argsort(keys);
+
+        auto find_root = [&](int idx) {
+            int root = idx;
+            while (zpar[root] != root) {
+                root = zpar[root];
+            }
+            while (zpar[idx] != root) {
+                int next = zpar[idx];
+                zpar[idx] = root;
+                idx = next;
+            }
+            return root;
+        };
+
+        for (uint32_t i : order) {
+            int idx = voxels[i];
+            parent[idx] = idx;
+            zpar[idx] = idx;
+            state[idx] = SPANNED;
+
+            int z = idx / plane;
+            int y = (idx % plane) / width;
+            int x = idx % width;
+            int neighbors[6];
+            int num_neighbors = 0;
+            if (z > z0) neighbors[num_neighbors++] = idx - plane;
+            if (z < z1 - 1) neighbors[num_neighbors++] = idx + plane;
+            if (y > 0) neighbors[num_neighbors++] = idx - width;
+            if (y < height - 1) neighbors[num_neighbors++] = idx + width;
+            if (x > 0) neighbors[num_neighbors++] = idx - 1;
+            if (x < width - 1) neighbors[num_neighbors++] = idx + 1;
+
+            for (int n = 0; n < num_neighbors; n++) {
+                if (state[neighbors[n]] != SPANNED) {
+                    continue;
+                }
+                int root = find_root(neighbors[n]);
+                if (root != idx) {
+                    parent[root] = idx;
+                    zpar[root] = idx;
+                }
+            }
+        }
+
+        for (size_t i = order.size(); i-- > 0;) {
+            int idx = voxels[order[i]];
+            int q = parent[idx];
+            if (key(parent[q]) == key(q)) {
+                parent[idx] = parent[q];
+            }
+            state[idx] = MEMBER;
+        }
+    }
+
+    /**
+     * Merges the trees of two face-adjacent voxels: their ancestor chains,
+     * both sorted by key, are merged like sorted lists, and nodes of equal
+     * keys on both chains become one node.
+     */
+    void connect(int a, int b) {
+        std::vector<int> &parent = scratch.parent;
+        int x = level_root(a);
+        int y = level_root(b);
+        if (key(x) > key(y)) {
+            std::swap(x, y);
+        }
+        while (x != y) {
+            // key(x) <= key(y): climb x while its parent stays below y
+            int z = parent[x] == x ? -1 : level_root(parent[x]);
+            if (z >= 0 && key(z) <= key(y)) {
+                x = z;
+                continue;
+            }
+            parent[x] = y;
+            if (z < 0) {
+                break;
+            }
+            x = y;
+            y = z;
+        }
+    }
+};
+
+
+/**
+ * Feeds the hierarchy with the min-tree of a component, children before
+ * parents: each voxel is joined to its parent once every voxel pointing
+ * to it is, and a node is emitted when its canonical voxel is reached, so
+ * ties never yield partial components. No global sort is needed, and the
+ * order only depends on the tree and on the order of `visited`.
+ * Restores scratch.state to NOT_MEMBER on return.
+ * Time complexity: O(n) plus the joins
+ */
+template <typename EdgeWeight>
+void replay_min_tree(
+    HierarchyBuilder<EdgeWeight> &hierarchy,
+    const std::vector<int> &visited,
+    const EdgeWeight &weight,
+    TreeScratch &scratch
+) {
+    const std::vector<int> &parent = scratch.parent;
+    std::vector<int> &children = scratch.work;
+    std::vector<uint8_t> &state = scratch.state;
+
+    for (int idx : visited) {
+        children[idx] = 0;
+    }
+    for (int idx : visited) {
+        if (parent[idx] != idx) {
+            children[parent[idx]]++;
+        }
+    }
+
+    std::vector<int> ready;  // voxels whose children are all joined
+    for (int idx : visited) {
+        if (children[idx] == 0) {
+            ready.push_back(idx);
+        } else {
+            state[idx] = SPANNED;  // has children, so its node is not a lone voxel
+        }
+    }
+
+    std::vector<int> node(1);
+    while (!ready.empty()) {
+        int idx = ready.back();
+        ready.pop_back();
+        int up = parent[idx];
+        bool canonical = up == idx || weight.vertex_key(up) != weight.vertex_key(idx);
+        if (canonical && state[idx] == SPANNED) {
+            node[0] = idx;
+            hierarchy.emit_components(node, static_cast<float>(weight.vertex_key(idx)));
+        }
+        state[idx] = NOT_MEMBER;
+        if (up != idx) {
+            hierarchy.join(idx, up);
+            if (--children[up] == 0) {
+                ready.push_back(up);
+            }
+        }
+    }
+}
+
+#endif // COMPONENT_TREE_H
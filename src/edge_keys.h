@@ -0,0 +1,134 @@
+#ifndef EDGE_KEYS_H
+#define EDGE_KEYS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include "half.h"
+
+/**
+ * Sort key of the edge between two voxels with contour values a and b,
+ * ordered like their mean. Integer contours keep the exact integer sum,
+ * so keys are only as wide as the input requires and can be counting
+ * sorted. `level` maps a key back to the mean in contour units.
+ */
+template <typename T>
+struct EdgeKey {
+    using type = float;
+
+    static type make(T a, T b) {
+        return 0.5f * (static_cast<float>(a) + static_cast<float>(b));
+    }
+
+    static float level(type key) {
+        return key;
+    }
+};
+
+template <>
+struct EdgeKey<double> {
+    using type = double;
+
+    static type make(double a, double b) {
+        return 0.5 * (a + b);
+    }
+
+    static float level(type key) {
+        return static_cast<float>(key);
+    }
+};
+
+template <>
+struct EdgeKey<uint8_t> {
+    using type = uint16_t;
+
+    static type make(uint8_t a, uint8_t b) {
+        return static_cast<type>(a) + b;
+    }
+
+    static float level(type key) {
+        return 0.5f * key;
+    }
+};
+
+template <>
+struct EdgeKey<uint16_t> {
+    using type = uint32_t;
+
+    static type make(uint16_t a, uint16_t b) {
+        return static_cast<type>(a) + b;
+    }
+
+    static float level(type key) {
+        return 0.5f * key;
+    }
+};
+
+
+/**
+ * Order-preserving 16-bit key of a float: its binary16 truncation with
+ * the bits remapped so that unsigned order follows numeric order.
+ * Magnitudes beyond the float16 range share the infinity key and the
+ * ones below its subnormal step share zero, so keys keep about three
+ * significant digits and can always be counting sorted.
+ */
+inline uint16_t compact_key(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    uint16_t half;
+    if (magnitude >= 0x47800000) {
+        // at least 2^16, inf and nan
+        half = 0x7c00;
+    } else if (magnitude >= 0x38800000) {
+        // normal, rebias the exponent from 127 to 15
+        half = static_cast<uint16_t>((magnitude - 0x38000000) >> 13);
+    } else {
+        // subnormal, in steps of 2^-24
+        half = static_cast<uint16_t>(std::fabs(value) * 16777216.0f);
+    }
+    return (bits >> 31) ? static_cast<uint16_t>(0x7fff - half) : static_cast<uint16_t>(0x8000 + half);
+}
+
+
+/**
+ * Indices that sort the keys in increasing order, ties in index order.
+ * Integer keys with a small range are counting sorted in O(n + range),
+ * others use std::sort.
+ */
+template <typename Key>
+std::vector<uint32_t> argsort(const std::vector<Key> &keys)
+{
+    std::vector<uint32_t> indices(keys.size());
+
+    if constexpr (std::is_integral<Key>::value) {
+        const size_t max_range = size_t(1) << 20;
+        Key max_key = keys.empty() ? 0 : *std::max_element(keys.begin(), keys.end());
+        if (static_cast<size_t>(max_key) < max_range) {
+            std::vector<size_t> offsets(static_cast<size_t>(max_key) + 2, 0);
+            for (Key key : keys) {
+                offsets[static_cast<size_t>(key) + 1]++;
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            for (size_t i = 0; i < keys.size(); i++) {
+                indices[offsets[keys[i]]++] = static_cast<uint32_t>(i);
+            }
+            return indices;
+        }
+    }
+
+    std::iota(indices.begin(), indices.end(), 0);
+    std::sort(indices.begin(), indices.end(),
+              [&keys](uint32_t left, uint32_t right) -> bool {
+                  return keys[left] < keys[right] || (keys[left] == keys[right] && left < right);
+              });
+
+    return indices;
+}
+
+#endif // EDGE_KEYS_H
@@ -0,0 +1,169 @@
+#ifndef EDGE_WEIGHTS_H
+#define EDGE_WEIGHTS_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include "edge_keys.h"
+
+/**
+ * Edge weight policies between face-adjacent voxels.
+ *
+ * A policy is a small value type called as weight(idx, nidx) on C-order
+ * voxel indices. It returns the float level of the edge and, through
+ * key(idx, nidx), a sort key ordered like that level, as narrow as the
+ * input allows. The pipeline is templated on the policy, so weights are
+ * inlined in the edge loops instead of called indirectly.
+ * Policies whose edges weigh the larger key of their two voxels also
+ * expose vertex_key(idx), so their hierarchy can sort voxels instead.
+ */
+
+/**
+ * Sort key of order statistics of two values: integers and doubles keep
+ * their type, other floating types are compared as float.
+ */
+template <typename T>
+using ValueKey = std::conditional_t<
+    std::is_integral<T>::value || std::is_same<T, double>::value, T, float
+>;
+
+
+/**
+ * Mean of the two contour values, the classic watershed on boundaries.
+ */
+template <typename Values>
+struct MeanWeight {
+    using value_type = typename Values::value_type;
+    using key_type = typename EdgeKey<value_type>::type;
+
+    Values values;
+
+    key_type key(int idx, int nidx) const {
+        return EdgeKey<value_type>::make(values[idx], values[nidx]);
+    }
+
+    float operator()(int idx, int nidx) const {
+        return EdgeKey<value_type>::level(key(idx, nidx));
+    }
+};
+
+
+/**
+ * Larger of the two contour values, so thin boundaries are never crossed
+ * by averaging with a low neighbor.
+ * Its hierarchy is the min-tree of the contours, so it also keys voxels.
+ */
+template <typename Values>
+struct MaxWeight {
+    using value_type = typename Values::value_type;
+    using key_type = ValueKey<value_type>;
+
+    Values values;
+
+    key_type key(int idx, int nidx) const {
+        return std::max(vertex_key(idx), vertex_key(nidx));
+    }
+
+    key_type vertex_key(int idx) const {
+        return static_cast<key_type>(values[idx]);
+    }
+
+    float operator()(int idx, int nidx) const {
+        return static_cast<float>(key(idx, nidx));
+    }
+};
+
+
+/**
+ * Smaller of the two contour values.
+ */
+template <typename Values>
+struct MinWeight {
+    using value_type = typename Values::value_type;
+    using key_type = ValueKey<value_type>;
+
+    Values values;
+
+    key_type key(int idx, int nidx) const {
+        return std::min(static_cast<key_type>(values[idx]), static_cast<key_type>(values[nidx]));
+    }
+
+    float operator()(int idx, int nidx) const {
+        return static_cast<float>(key(idx, nidx));
+    }
+};
+
+
+/**
+ * Absolute difference of the two values, i.e. a gradient magnitude,
+ * which makes intensity images usable as contours.
+ */
+template <typename Values>
+struct AbsDiffWeight {
+    using value_type = typename Values::value_type;
+    using key_type = ValueKey<value_type>;
+
+    Values values;
+
+    key_type key(int idx, int nidx) const {
+        key_type a = static_cast<key_type>(values[idx]);
+        key_type b = static_cast<key_type>(values[nidx]);
+        return a > b ? a - b : b - a;
+    }
+
+    float operator()(int idx, int nidx) const {
+        return static_cast<float>(key(idx, nidx));
+    }
+};
+
+
+/**
+ * Weight read from external per-axis affinities, one volume per axis
+ * (z, y, x). Channel a at voxel v holds the affinity between v and its
+ * predecessor along a, and the weight is its complement, the largest
+ * affinity minus it: 1 for floating inputs and the dtype maximum for
+ * integers, so high affinities are merged first.
+ */
+template <typename Values>
+struct AffinityWeight {
+    using value_type = typename Values::value_type;
+    using key_type = ValueKey<value_type>;
+
+    std::array<Values, 3> affinities;
+    int height;
+    int width;
+
+    key_type key(int idx, int nidx) const {
+        int hi = std::max(idx, nidx);
+        int step = hi - std::min(idx, nidx);
+        // singleton axes have no edges, so the tests never collide
+        int axis = step == height * width ? 0 : step == width ? 1 : 2;
+        key_type affinity = static_cast<key_type>(affinities[axis][hi]);
+        if constexpr (std::is_integral<key_type>::value) {
+            return std::numeric_limits<key_type>::max() - affinity;
+        } else {
+            return key_type(1) - affinity;
+        }
+    }
+
+    float operator()(int idx, int nidx) const {
+        return static_cast<float>(key(idx, nidx));
+    }
+};
+
+
+/**
+ * Whether a policy keys voxels, i.e. exposes vertex_key(idx).
+ */
+template <typename EdgeWeight, typename = void>
+struct KeysVoxels : std::false_type {};
+
+template <typename EdgeWeight>
+struct KeysVoxels<
+    EdgeWeight, std::void_t<decltype(std::declval<const EdgeWeight &>().vertex_key(0))>
+> : std::true_type {};
+
+#endif // EDGE_WEIGHTS_H
@@ -0,0 +1,212 @@
+#ifndef EXTINCTION_H
+#define EXTINCTION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include "edge_keys.h"
+#include "union_find.h"
+
+/**
+ * Orders of the merges of a component hierarchy: by edge altitude, or by
+ * the extinction value of an attribute of the minima they join.
+ */
+enum class Attribute {
+    ALTITUDE,  // edge weights, the plain hierarchical watershed
+    AREA,      // physical volume of the smaller side
+    VOLUME,    // water volume of the smaller side's lake up to the saddle
+    DYNAMICS,  // depth of the shallower side's lake below the saddle
+};
+
+
+/**
+ * Spanning tree edges of a component in the merge order of an attribute
+ * hierarchy. The first `num_pruned` edges have extinction values of at
+ * most min_extinction and join the minima into `basins`, one voxel each,
+ * paired with the highest altitude at which each basin was completed;
+ * every later edge merges two basins or unions of basins.
+ */
+struct AttributeMerges {
+    std::vector<int> edges;        // (u, v) flattened
+    std::vector<float> extinction; // per edge
+    size_t num_pruned = 0;
+    std::vector<int> basins;
+    std::vector<float> basin_levels;
+};
+
+
+/**
+ * Reorders the Kruskal merges of a component by extinction values
+ * (Najman, Cousty and Perret, watersheds by attribute).
+ *
+ * A first Kruskal pass over `edges`, ordered by `keys`, keeps the area,
+ * lake volume and lowest level of every region. A region holds a minimum
+ * once it has a merge below the current level, so a merge between two
+ * such regions kills the minimum of the side with the smaller attribute,
+ * and that attribute is the extinction value of the merge; merges that
+ * only grow a region, e.g. across a plateau or over single voxels, have
+ * none. Sorting the spanning tree edges by extinction values, stably so
+ * ties keep their altitude order, gives the attribute hierarchy.
+ *
+ * Voxel ranges of `blocks` are regions joined below every edge; ranges of
+ * more than one voxel hold a minimum at their lowest internal face.
+ * Levels are exact edge weights, made monotone along the merges so that
+ * compact keys may reorder close weights. `unit` scales voxel counts into
+ * physical volumes.
+ *
+ * `index_of` is a volume shared by all components, -1 everywhere on entry
+ * and on return.
+ * Time complexity: O(n α(n)) plus the two sorts
+ */
+template <typename EdgeWeight, typename Key>
+AttributeMerges attribute_merges(
+    const std::vector<int> &visited,
+    const std::vector<int> &edges,
+    const std::vector<Key> &keys,
+    const std::vector<int> &blocks,
+    const EdgeWeight &weight,
+    Attribute attribute,
+    float unit,
+    float min_extinction,
+    int depth,
+    int height,
+    int width,
+    std::vector<int> &index_of
+) {
+    const float none = std::numeric_limits<float>::infinity();
+    int n = static_cast<int>(visited.size());
+    for (int i = 0; i < n; i++) {
+        index_of[visited[i]] = i;
+    }
+
+    DenseSets regions(n);
+    std::vector<double> area(n, 1.0);
+    std::vector<double> volume(n, 0.0);  // at the level of the last merge
+    std::vector<float> top(n, -none);    // level of the last merge
+    std::vector<float> lowest(n, none);  // lowest merge, none for lone voxels
+
+    int plane = height * width;
+    for (size_t b = 0; b < blocks.size(); b += 2) {
+        int start = blocks[b];
+        int end = blocks[b + 1];
+        int root = start;
+        float level = none;
+        for (int i = start; i < end; i++) {
+            if (i > start) {
+                root = regions.unite_roots(regions.find(root), regions.find(i));
+            }
+            int idx = visited[i];
+            int z = idx / plane;
+            int y = (idx % plane) / width;
+            int x = idx % width;
+            int neighbors[3];
+            int num_neighbors = 0;
+            if (z < depth - 1) neighbors[num_neighbors++] = idx + plane;
+            if (y < height - 1) neighbors[num_neighbors++] = idx + width;
+            if (x < width - 1) neighbors[num_neighbors++] = idx + 1;
+            for (int k = 0; k < num_neighbors; k++) {
+                int j = index_of[neighbors[k]];
+                if (j >= start && j < end) {
+                    level = std::min(level, weight(idx, neighbors[k]));
+                }
+            }
+        }
+        area[root] = end - start;
+        lowest[root] = level;
+        top[root] = level == none ? -none : level;
+    }
+
+    auto lake_volume = [&](int root, float level) {
+        return lowest[root] == none ? 0.0 : volume[root] + area[root] * (level - top[root]);
+    };
+    auto measure = [&](int root, float level) -> double {
+        switch (attribute) {
+        case Attribute::AREA:
+            return area[root] * unit;
+        case Attribute::VOLUME:
+            return lake_volume(root, level) * unit;
+        case Attribute::DYNAMICS:
+            return level - lowest[root];
+        default:
+            return level;
+        }
+    };
+
+    AttributeMerges merges;
+    std::vector<int> tree;
+    std::vector<float> levels;
+    tree.reserve(2 * std::max(n - 1, 0));
+    for (uint32_t e : argsort(keys)) {
+        int u = edges[2 * e];
+        int v = edges[2 * e + 1];
+        int root_u = regions.find(index_of[u]);
+        int root_v = regions.find(index_of[v]);
+        if (root_u == root_v) {
+            continue;
+        }
+
+        float level = std::max({weight(u, v), top[root_u], top[root_v]});
+        bool minima = lowest[root_u] < level && lowest[root_v] < level;
+        merges.extinction.push_back(
+            minima ? static_cast<float>(std::min(measure(root_u, level), measure(root_v, level))) : 0.0f
+        );
+        tree.push_back(u);
+        tree.push_back(v);
+        levels.push_back(level);
+
+        double merged_area = area[root_u] + area[root_v];
+        double merged_volume = lake_volume(root_u, level) + lake_volume(root_v, level);
+        float merged_lowest = std::min({lowest[root_u], lowest[root_v], level});
+        int root = regions.unite_roots(root_u, root_v);
+        area[root] = merged_area;
+        volume[root] = merged_volume;
+        top[root] = level;
+        lowest[root] = merged_lowest;
+    }
+
+    std::vector<uint32_t> order(levels.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return merges.extinction[a] < merges.extinction[b];
+    });
+
+    // basins: the regions left by the pruned merges, at their highest level
+    DenseSets basins(n);
+    std::vector<float> basin_level(n, -none);
+    for (size_t b = 0; b < blocks.size(); b += 2) {
+        for (int i = blocks[b] + 1; i < blocks[b + 1]; i++) {
+            basins.unite_roots(basins.find(blocks[b]), basins.find(i));
+        }
+    }
+    merges.edges.reserve(tree.size());
+    std::vector<float> extinction(order.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        uint32_t e = order[k];
+        merges.edges.push_back(tree[2 * e]);
+        merges.edges.push_back(tree[2 * e + 1]);
+        extinction[k] = merges.extinction[e];
+        if (extinction[k] <= min_extinction) {
+            merges.num_pruned++;
+            int root_u = basins.find(index_of[tree[2 * e]]);
+            int root_v = basins.find(index_of[tree[2 * e + 1]]);
+            float level = std::max({levels[e], basin_level[root_u], basin_level[root_v]});
+            basin_level[basins.unite_roots(root_u, root_v)] = level;
+        }
+    }
+    merges.extinction = std::move(extinction);
+    for (int i = 0; i < n; i++) {
+        if (basins.find(i) == i && basin_level[i] > -none) {
+            merges.basins.push_back(visited[i]);
+            merges.basin_levels.push_back(basin_level[i]);
+        }
+    }
+
+    for (int idx : visited) {
+        index_of[idx] = -1;
+    }
+    return merges;
+}
+
+#endif // EXTINCTION_H
@@ -0,0 +1,355 @@
+#ifndef FLOOD_H
+#define FLOOD_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "edge_keys.h"
+#include "union_find.h"
+
+// flood states of the voxels, kept in a volume shared by all components;
+// SEEDED voxels are members known to be reached no later than their lowest face
+enum : uint8_t { NOT_MEMBER = 0, MEMBER = 1, SPANNED = 2, SEEDED = 3 };
+
+
+/**
+ * Unsigned 64-bit key ordered like `key`: integers are widened and
+ * floating point bits are flipped so that negative values come first.
+ */
+template <typename Key>
+uint64_t order_key(Key key) {
+    if constexpr (std::is_integral<Key>::value) {
+        uint64_t bits = static_cast<uint64_t>(key);
+        return std::is_signed<Key>::value ? bits ^ (uint64_t(1) << 63) : bits;
+    } else if constexpr (sizeof(Key) == sizeof(uint32_t)) {
+        uint32_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return (bits >> 31) ? ~bits : bits | 0x80000000u;
+    } else {
+        uint64_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+    }
+}
+
+
+/**
+ * Monotone bucket queue of faces by keys of at most 16 bits. Buckets are
+ * offset by the lowest key of the current flood and kept across floods,
+ * so they are allocated once per call, up to the widest key range seen.
+ * Time complexity: O(1) per push, O(1) amortized per pop plus the key range
+ */
+class BucketQueue {
+private:
+    std::vector<std::vector<std::pair<int, int>>> buckets;
+    uint64_t base = 0;
+    size_t cursor = 0;
+    size_t count = 0;
+
+public:
+    /**
+     * Starts a flood whose keys are all at least `min_key`; the queue is empty.
+     */
+    void reset(uint64_t min_key) {
+        base = min_key;
+        cursor = 0;
+    }
+
+    void push(uint64_t key, int u, int v) {
+        size_t bucket = static_cast<size_t>(key - base);
+        if (bucket >= buckets.size()) {
+            buckets.resize(bucket + 1);
+        }
+        buckets[bucket].emplace_back(u, v);
+        count++;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    std::pair<int, int> pop() {
+        while (buckets[cursor].empty()) {
+            cursor++;
+        }
+        std::pair<int, int> face = buckets[cursor].back();
+        buckets[cursor].pop_back();
+        count--;
+        return face;
+    }
+};
+
+
+/**
+ * Radix heap of faces (Ahuja et al.) for wider integer and floating point
+ * keys: an entry lives in the bucket of the highest bit where its key
+ * differs from the last popped one, so pops must be monotone.
+ * Time complexity: O(1) per push, O(log key range) amortized per pop
+ */
+class RadixHeap {
+private:
+    std::array<std::vector<std::tuple<uint64_t, int, int>>, 65> buckets;
+    uint64_t last = 0;
+    size_t count = 0;
+
+    static int bucket_of(uint64_t key, uint64_t last) {
+        uint64_t diff = key ^ last;
+        int width = 0;
+        for (int shift = 32; shift > 0; shift /= 2) {
+            if (diff >> shift) {
+                diff >>= shift;
+                width += shift;
+            }
+        }
+        return width + static_cast<int>(diff);
+    }
+
+public:
+    /**
+     * Starts a flood whose keys are all at least `min_key`; the queue is empty.
+     */
+    void reset(uint64_t min_key) {
+        last = min_key;
+    }
+
+    void push(uint64_t key, int u, int v) {
+        buckets[bucket_of(key, last)].emplace_back(key, u, v);
+        count++;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    std::pair<int, int> pop() {
+        if (buckets[0].empty()) {
+            size_t i = 1;
+            while (buckets[i].empty()) {
+                i++;
+            }
+            last = std::get<0>(buckets[i][0]);
+            for (const auto &entry : buckets[i]) {
+                last = std::min(last, std::get<0>(entry));
+            }
+            for (const auto &entry : buckets[i]) {
+                buckets[bucket_of(std::get<0>(entry), last)].push_back(entry);
+            }
+            buckets[i].clear();
+        }
+        auto [key, u, v] = buckets[0].back();
+        buckets[0].pop_back();
+        count--;
+        return {u, v};
+    }
+};
+
+
+/**
+ * Scratch of the flood engine, reused by every component of a call.
+ * `state` is NOT_MEMBER everywhere between components.
+ */
+struct FloodScratch {
+    std::vector<uint8_t> state;
+    std::vector<int> seeds;  // seed faces (u, v) of the current component, flattened
+    BucketQueue buckets;
+    RadixHeap radix;
+
+    explicit FloodScratch(size_t size) : state(size, NOT_MEMBER) {}
+};
+
+
+/**
+ * Calls merge(u, v) on every face of the component `visited` in
+ * non-decreasing key order, i.e. Kruskal over all its faces, without
+ * storing or sorting them: a priority flood grows from the minima and a
+ * face is generated when one of its voxels is first reached.
+ *
+ * Every voxel whose lowest faces all lead to voxels with the same lowest
+ * key, and none of them already seeded, seeds one of those faces; both
+ * voxels are then SEEDED, as are voxels skipped because a lowest face
+ * leads to a seeded or lower voxel. Each voxel is thus reached no later
+ * than its lowest face, so a newly reached voxel only generates faces at
+ * or above the current key and pops are monotone. A face may be popped
+ * twice, once as a seed; merges are idempotent on it.
+ *
+ * The queue holds the seeds, about one per regional minimum, and the
+ * frontier of the flooded regions.
+ * Time complexity: O(n) queue operations, with n the component size
+ */
+template <typename Queue, typename KeyOf, typename Merge>
+void priority_flood(
+    const std::vector<int> &visited,
+    const KeyOf &key_of,
+    int depth,
+    int height,
+    int width,
+    FloodScratch &scratch,
+    Queue &queue,
+    Merge &&merge
+) {
+    std::vector<uint8_t> &state = scratch.state;
+    std::vector<int> &seeds = scratch.seeds;
+    int plane = height * width;
+
+    // face-adjacent members, lowest voxel index first
+    auto members = [&](int idx, int *neighbors) {
+        int z = idx / plane;
+        int y = (idx % plane) / width;
+        int x = idx % width;
+        int num_neighbors = 0;
+        if (z > 0 && state[idx - plane] != NOT_MEMBER) neighbors[num_neighbors++] = idx - plane;
+        if (y > 0 && state[idx - width] != NOT_MEMBER) neighbors[num_neighbors++] = idx - width;
+        if (x > 0 && state[idx - 1] != NOT_MEMBER) neighbors[num_neighbors++] = idx - 1;
+        if (x < width - 1 && state[idx + 1] != NOT_MEMBER) neighbors[num_neighbors++] = idx + 1;
+        if (y < height - 1 && state[idx + width] != NOT_MEMBER) neighbors[num_neighbors++] = idx + width;
+        if (z < depth - 1 && state[idx + plane] != NOT_MEMBER) neighbors[num_neighbors++] = idx + plane;
+        return num_neighbors;
+    };
+    auto lowest_key = [&](int idx) {
+        int neighbors[6];
+        int num_neighbors = members(idx, neighbors);
+        uint64_t lowest = order_key(key_of(idx, neighbors[0]));
+        for (int i = 1; i < num_neighbors; i++) {
+            lowest = std::min(lowest, order_key(key_of(idx, neighbors[i])));
+        }
+        return lowest;
+    };
+
+    for (int idx : visited) {
+        state[idx] = MEMBER;
+    }
+
+    seeds.clear();
+    uint64_t min_key = ~uint64_t(0);
+    if (visited.size() > 1) {
+        for (int idx : visited) {
+            if (state[idx] == SEEDED) {
+                continue;
+            }
+            int neighbors[6];
+            uint64_t keys[6];
+            int num_neighbors = members(idx, neighbors);
+            uint64_t lowest = ~uint64_t(0);
+            for (int i = 0; i < num_neighbors; i++) {
+                keys[i] = order_key(key_of(idx, neighbors[i]));
+                lowest = std::min(lowest, keys[i]);
+            }
+
+            bool reached = false;
+            for (int i = 0; i < num_neighbors && !reached; i++) {
+                reached = keys[i] == lowest && state[neighbors[i]] == SEEDED;
+            }
+            int partner = -1;
+            for (int i = 0; i < num_neighbors && !reached; i++) {
+                if (keys[i] == lowest) {
+                    reached = lowest_key(neighbors[i]) < lowest;
+                    partner = partner < 0 ? neighbors[i] : partner;
+                }
+            }
+            state[idx] = SEEDED;
+            if (!reached) {
+                state[partner] = SEEDED;
+                seeds.push_back(idx);
+                seeds.push_back(partner);
+                min_key = std::min(min_key, lowest);
+            }
+        }
+    }
+
+    queue.reset(min_key);
+    for (size_t s = 0; s < seeds.size(); s += 2) {
+        queue.push(order_key(key_of(seeds[s], seeds[s + 1])), seeds[s], seeds[s + 1]);
+    }
+
+    auto reach = [&](int idx) {
+        if (state[idx] == SPANNED) {
+            return;
+        }
+        state[idx] = SPANNED;
+        int neighbors[6];
+        int num_neighbors = members(idx, neighbors);
+        for (int i = 0; i < num_neighbors; i++) {
+            if (state[neighbors[i]] != SPANNED) {
+                queue.push(order_key(key_of(idx, neighbors[i])), idx, neighbors[i]);
+            }
+        }
+    };
+
+    while (!queue.empty()) {
+        auto [u, v] = queue.pop();
+        merge(u, v);
+        reach(u);
+        reach(v);
+    }
+
+    for (int idx : visited) {
+        state[idx] = NOT_MEMBER;
+    }
+}
+
+
+/**
+ * Floods a component with the keys the hierarchy sorts by: the bucket
+ * queue for keys of at most 16 bits, compact keys included, and the
+ * radix heap otherwise. See priority_flood.
+ */
+template <typename EdgeWeight, typename Merge>
+void flood_merges(
+    const std::vector<int> &visited,
+    const EdgeWeight &weight,
+    bool compact_keys,
+    int depth,
+    int height,
+    int width,
+    FloodScratch &scratch,
+    Merge &&merge
+) {
+    using Key = typename EdgeWeight::key_type;
+
+    if (compact_keys && sizeof(Key) > sizeof(uint16_t)) {
+        auto key_of = [&](int u, int v) { return compact_key(weight(u, v)); };
+        priority_flood(visited, key_of, depth, height, width, scratch, scratch.buckets, merge);
+        return;
+    }
+    auto key_of = [&](int u, int v) { return weight.key(u, v); };
+    if constexpr (std::is_integral<Key>::value && sizeof(Key) <= sizeof(uint16_t)) {
+        priority_flood(visited, key_of, depth, height, width, scratch, scratch.buckets, merge);
+    } else {
+        priority_flood(visited, key_of, depth, height, width, scratch, scratch.radix, merge);
+    }
+}
+
+
+/**
+ * Minimum spanning tree of a component, flattened as (u, v) pairs in
+ * ascending key order, for the stages that take edge lists: attribute
+ * hierarchies and saliency maps.
+ */
+template <typename EdgeWeight>
+std::vector<int> flood_spanning_tree(
+    const std::vector<int> &visited,
+    const EdgeWeight &weight,
+    bool compact_keys,
+    int depth,
+    int height,
+    int width,
+    FloodScratch &scratch
+) {
+    std::vector<int> tree;
+    tree.reserve(2 * (visited.size() - 1));
+    UnionFind uf(visited);
+    flood_merges(visited, weight, compact_keys, depth, height, width, scratch, [&](int u, int v) {
+        if (uf.unite(u, v)) {
+            tree.push_back(u);
+            tree.push_back(v);
+        }
+    });
+    return tree;
+}
+
+#endif // FLOOD_H
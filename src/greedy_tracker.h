@@ -0,0 +1,208 @@
+#ifndef GREEDY_TRACKER_H
+#define GREEDY_TRACKER_H
+
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "linking.h"
+
+namespace nb = nanobind;
+
+/**
+ * Compressed adjacency lists of an undirected graph given as an edge list.
+ */
+struct Adjacency {
+    std::vector<int> offsets;
+    std::vector<int> neighbors;
+
+    Adjacency(int num_nodes, const int *edges, size_t num_edges)
+        : offsets(num_nodes + 1, 0), neighbors(2 * num_edges) {
+        for (size_t e = 0; e < 2 * num_edges; e++) {
+            offsets[edges[e] + 1]++;
+        }
+        for (int i = 0; i < num_nodes; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t e = 0; e < num_edges; e++) {
+            neighbors[fill[edges[2 * e]]++] = edges[2 * e + 1];
+            neighbors[fill[edges[2 * e + 1]]++] = edges[2 * e];
+        }
+    }
+};
+
+
+/**
+ * Compressed lists of the links incident to each node, as source or target.
+ */
+struct Incidence {
+    std::vector<int> offsets;
+    std::vector<int> links;
+
+    Incidence(int num_nodes, const int *edges, size_t num_edges)
+        : offsets(num_nodes + 1, 0), links(2 * num_edges) {
+        for (size_t e = 0; e < 2 * num_edges; e++) {
+            offsets[edges[e] + 1]++;
+        }
+        for (int i = 0; i < num_nodes; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t e = 0; e < num_edges; e++) {
+            links[fill[edges[2 * e]]++] = static_cast<int>(e);
+            links[fill[edges[2 * e + 1]]++] = static_cast<int>(e);
+        }
+    }
+};
+
+
+/**
+ * Greedy tracking over hypotheses and link candidates, for quick looks
+ * where the ILP is too slow.
+ *
+ * Nodes and links are candidates in a max-priority queue scored by the
+ * weight they add: a link adds its own weight plus the weights of its
+ * endpoints that are not selected yet, plus `division_weight` when it
+ * gives its source a second child. Nodes alone add their weight. The best
+ * candidate is taken while its score is positive; selecting a node blocks
+ * every node it conflicts with. Scores change as the solution grows and
+ * may rise, since a selected node's weight no longer counts and a positive
+ * `division_weight` applies from the second child on, so the links of a
+ * node are queued again with their new scores whenever it is selected or
+ * gains a child. Entries are never updated in place: a popped entry whose
+ * score fell is queued again, one whose score rose is dropped for its
+ * newer copy (lazy invalidation), so the best candidate is always taken.
+ *
+ * Nodes are hypotheses of any frame, `conflicts` are pairs of overlapping
+ * hypotheses and `links` are (source, target) pairs from frame t to t + 1.
+ * Returns (selected node ids, parent of every node or -1, selected link ids).
+ * Time complexity: O((N + L) log(N + L) + conflicts)
+ */
+inline nb::tuple greedy_tracking(
+    const Values &node_weights,
+    const IndexPairs &conflicts,
+    const IndexPairs &links,
+    const Values &link_weights,
+    float division_weight,
+    int max_children
+) {
+    int num_nodes = static_cast<int>(node_weights.shape(0));
+    int num_links = static_cast<int>(links.shape(0));
+    if (link_weights.shape(0) != links.shape(0)) {
+        throw std::invalid_argument("links and link_weights must have the same length");
+    }
+    check_indices(conflicts.data(), 2 * conflicts.shape(0), num_nodes, "conflicts");
+    check_indices(links.data(), 2 * links.shape(0), num_nodes, "links");
+    if (max_children < 1) {
+        throw std::invalid_argument("max_children must be at least 1");
+    }
+
+    std::vector<int> selected_nodes;
+    std::vector<int> parents(num_nodes, -1);
+    std::vector<int> selected_links;
+    {
+        nb::gil_scoped_release release;
+
+        const float *w_node = node_weights.data();
+        const float *w_link = link_weights.data();
+        const int *link_data = links.data();
+        Adjacency conflict_graph(num_nodes, conflicts.data(), conflicts.shape(0));
+        Incidence node_links(num_nodes, link_data, num_links);
+
+        std::vector<char> selected(num_nodes, 0);
+        std::vector<char> blocked(num_nodes, 0);
+        std::vector<int> num_children(num_nodes, 0);
+
+        // returns NaN for candidates that can no longer be taken;
+        // ids below num_links are links, the others are nodes
+        auto score = [&](int id) -> float {
+            if (id < num_links) {
+                int source = link_data[2 * id];
+                int target = link_data[2 * id + 1];
+                if (blocked[source] || blocked[target] || parents[target] >= 0 ||
+                    num_children[source] >= max_children) {
+                    return NAN;
+                }
+                float s = w_link[id];
+                s += selected[source] ? 0.0f : w_node[source];
+                s += selected[target] ? 0.0f : w_node[target];
+                s += num_children[source] > 0 ? division_weight : 0.0f;
+                return s;
+            }
+            int node = id - num_links;
+            return selected[node] || blocked[node] ? NAN : w_node[node];
+        };
+
+        std::priority_queue<std::pair<float, int>> queue;
+        auto push = [&](int id) {
+            float s = score(id);
+            if (s > 0.0f) {
+                queue.emplace(s, id);
+            }
+        };
+        auto push_links = [&](int node) {
+            for (int k = node_links.offsets[node]; k < node_links.offsets[node + 1]; k++) {
+                push(node_links.links[k]);
+            }
+        };
+        auto select = [&](int node) {
+            if (selected[node]) {
+                return;
+            }
+            selected[node] = 1;
+            selected_nodes.push_back(node);
+            for (int k = conflict_graph.offsets[node]; k < conflict_graph.offsets[node + 1]; k++) {
+                blocked[conflict_graph.neighbors[k]] = 1;
+            }
+        };
+
+        for (int id = 0; id < num_links + num_nodes; id++) {
+            push(id);
+        }
+
+        while (!queue.empty()) {
+            auto [queued, id] = queue.top();
+            queue.pop();
+            float s = score(id);
+            if (!(s > 0.0f)) {
+                continue;
+            }
+            if (s != queued) {
+                if (s < queued) {
+                    queue.emplace(s, id);
+                }
+                continue;
+            }
+
+            if (id < num_links) {
+                int source = link_data[2 * id];
+                int target = link_data[2 * id + 1];
+                select(source);
+                select(target);
+                parents[target] = source;
+                num_children[source]++;
+                selected_links.push_back(id);
+                push_links(source);
+                push_links(target);
+            } else {
+                select(id - num_links);
+                push_links(id - num_links);
+            }
+        }
+    }
+
+    size_t num_selected = selected_nodes.size();
+    size_t num_selected_links = selected_links.size();
+    return nb::make_tuple(
+        to_ndarray(std::move(selected_nodes), {num_selected}),
+        to_ndarray(std::move(parents), {static_cast<size_t>(num_nodes)}),
+        to_ndarray(std::move(selected_links), {num_selected_links})
+    );
+}
+
+#endif // GREEDY_TRACKER_H
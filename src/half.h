@@ -0,0 +1,53 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include <cstdint>
+#include <cstring>
+#include <nanobind/ndarray.h>
+
+/**
+ * IEEE 754 binary16 value, used to read float16 arrays without
+ * converting them to float32 first.
+ */
+struct Half {
+    uint16_t bits;
+
+    operator float() const {
+        uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1f;
+        uint32_t mantissa = bits & 0x3ff;
+        uint32_t result;
+        if (exponent == 0x1f) {
+            // inf and nan
+            result = sign | 0x7f800000 | (mantissa << 13);
+        } else if (exponent != 0) {
+            result = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        } else if (mantissa == 0) {
+            result = sign;
+        } else {
+            // subnormal, normalize the mantissa
+            exponent = 113;
+            while ((mantissa & 0x400) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            result = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+        float value;
+        std::memcpy(&value, &result, sizeof(value));
+        return value;
+    }
+};
+
+namespace nanobind::detail {
+    template <> struct dtype_traits<Half> {
+        static constexpr dlpack::dtype value {
+            (uint8_t) dlpack::dtype_code::Float, // type code
+            16, // size in bits
+            1   // lanes (simd), usually set to 1
+        };
+        static constexpr auto name = const_name("float16");
+    };
+}
+
+#endif // HALF_H
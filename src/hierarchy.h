@@ -0,0 +1,360 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "array_utils.h"
+#include "segment.h"
+#include "union_find.h"
+
+/**
+ * Filters and geometry shared by every stage that emits hypotheses.
+ * Sizes are physical volumes, i.e. voxel counts times the spacing product.
+ */
+struct HierarchyParams {
+    float min_num_pixels;
+    float max_num_pixels;
+    float min_frontier;
+    Spacing spacing;
+    float min_sphericity;
+};
+
+/**
+ * Attributes of a hierarchy component, updated on every union so that
+ * hypotheses can be scored and filtered before their masks exist.
+ */
+struct ComponentStats {
+    std::array<int64_t, 3> internal_faces = {0, 0, 0};  // adjacent member pairs along (z, y, x)
+    double boundary_sum = 0.0;                          // edge weights across the boundary
+    int64_t boundary_count = 0;                         // in-volume boundary faces
+
+    void add(const ComponentStats &other) {
+        for (int i = 0; i < 3; i++) {
+            internal_faces[i] += other.internal_faces[i];
+        }
+        boundary_sum += other.boundary_sum;
+        boundary_count += other.boundary_count;
+    }
+};
+
+/**
+ * Builds the merge hierarchy of a single foreground connected component
+ * and emits the components that pass the filters as segments.
+ *
+ * Merges must be fed in non-decreasing level order. Members of each
+ * component are kept as circular linked lists, so emitting a hypothesis
+ * costs O(size) and the statistics of a union are updated by scanning the
+ * smaller side only, which is O(n log n) over the whole hierarchy.
+ *
+ * Every emitted hypothesis records its parent, the next emitted hypothesis
+ * that contains it. Within one hierarchy two hypotheses overlap exactly
+ * when one is an ancestor of the other, so parents encode all conflicts.
+ *
+ * `EdgeWeight` returns the weight between a voxel and any face-adjacent
+ * voxel inside the volume; it scores the boundary of the components.
+ */
+template <typename EdgeWeight>
+class HierarchyBuilder {
+private:
+    std::vector<Segment> &segments;
+    const std::vector<int> &visited;   // internal index -> voxel index
+    const HierarchyParams &params;
+    const EdgeWeight &weight;
+    int depth;
+    int height;
+    int width;
+    UnionFind uf;
+    std::vector<int> next;             // circular member lists by internal index
+    std::vector<ComponentStats> stats; // valid at root internal indices
+    std::vector<int> top;              // a parentless hypothesis per root, -1 if none
+    std::vector<int> top_next;         // circular lists of parentless hypotheses
+    int first_segment;                 // index of the first segment emitted here
+    int num_segments;
+
+public:
+    HierarchyBuilder(
+        std::vector<Segment> &segments,
+        const std::vector<int> &visited,
+        const HierarchyParams &params,
+        const EdgeWeight &weight,
+        int depth,
+        int height,
+        int width
+    ) : segments(segments), visited(visited), params(params), weight(weight),
+        depth(depth), height(height), width(width),
+        uf(visited), next(visited.size()), stats(visited.size()),
+        top(visited.size(), -1), first_segment(segments.size()), num_segments(0) {
+        std::iota(next.begin(), next.end(), 0);
+
+        for (size_t i = 0; i < visited.size(); i++) {
+            int idx = visited[i];
+            for_each_neighbor(idx, [&](int nidx, int) {
+                stats[i].boundary_sum += weight(idx, nidx);
+                stats[i].boundary_count++;
+            });
+        }
+    }
+
+    /**
+     * Joins the components of voxels u and v at the given level and emits
+     * the result if it passes the filters.
+     * Returns true if u and v were in different components.
+     * Time complexity: O(size of the smaller component)
+     */
+    bool merge(int u, int v, float level) {
+        if (!join(u, v)) {
+            return false;
+        }
+        if (level > params.min_frontier) {
+            emit(uf.find_index(u), uf.get_size(u), true);
+        }
+        return true;
+    }
+
+    /**
+     * Joins the components of voxels u and v without emitting, for merges
+     * completed together by emit_components.
+     * Returns true if u and v were in different components.
+     * Time complexity: O(size of the smaller component)
+     */
+    bool join(int u, int v) {
+        int root_u = uf.find_index(u);
+        int root_v = uf.find_index(v);
+        if (root_u == root_v) {
+            return false;
+        }
+
+        ComponentStats merged = stats[root_u];
+        merged.add(stats[root_v]);
+        if (uf.get_size(u) <= uf.get_size(v)) {
+            merge_shared_faces(root_u, root_v, merged);
+        } else {
+            merge_shared_faces(root_v, root_u, merged);
+        }
+
+        uf.unite(u, v);
+        std::swap(next[root_u], next[root_v]);  // splices both member lists
+        int root = uf.find_index(u);
+        stats[root] = merged;
+        top[root] = splice_tops(top[root_u], top[root_v]);
+        return true;
+    }
+
+    /**
+     * Emits the components of the given voxels, each once, as completed at
+     * `level`, e.g. all the components joined at one level of a min-tree.
+     * Time complexity: O(k log k + emitted sizes) for k voxels
+     */
+    void emit_components(const std::vector<int> &voxels, float level) {
+        if (level <= params.min_frontier) {
+            return;
+        }
+        std::vector<int> roots;
+        roots.reserve(voxels.size());
+        for (int u : voxels) {
+            roots.push_back(uf.find_index(u));
+        }
+        std::sort(roots.begin(), roots.end());
+        roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+        for (int root : roots) {
+            emit(root, uf.get_size(visited[root]), true);
+        }
+    }
+
+    /**
+     * Joins the singleton voxels visited[start, end), a set connected by
+     * edges of at most min_frontier such as a basin, before any other
+     * merge. Nothing is emitted, and the internal faces are counted once
+     * instead of by smaller-side scans.
+     * Time complexity: O(end - start)
+     */
+    void merge_block(int start, int end) {
+        ComponentStats merged;
+        for (int i = start; i < end; i++) {
+            merged.add(stats[i]);
+        }
+        for (int i = start; i < end; i++) {
+            int idx = visited[i];
+            for_each_neighbor(idx, [&](int nidx, int axis) {
+                int j = uf.find_index(nidx);
+                // every internal face once, from its lower voxel
+                if (nidx > idx && j >= start && j < end) {
+                    merged.internal_faces[axis]++;
+                    merged.boundary_sum -= 2.0 * weight(idx, nidx);
+                    merged.boundary_count -= 2;
+                }
+            });
+        }
+
+        for (int i = start + 1; i < end; i++) {
+            uf.unite(visited[start], visited[i]);
+            next[i - 1] = i;
+        }
+        next[end - 1] = start;
+        stats[uf.find_index(visited[start])] = merged;
+    }
+
+    /**
+     * Emits the whole component when no hypothesis passed the filters,
+     * so every foreground component yields at least one segment.
+     */
+    void finalize() {
+        if (num_segments == 0 && !visited.empty()) {
+            emit(uf.find_index(visited[0]), uf.get_size(visited[0]), false);
+        }
+    }
+
+    int count() const {
+        return num_segments;
+    }
+
+private:
+    /**
+     * Calls f(nidx, axis) for every face-adjacent voxel inside the volume.
+     */
+    template <typename F>
+    void for_each_neighbor(int idx, F &&f) const {
+        int z = idx / (height * width);
+        int y = (idx % (height * width)) / width;
+        int x = idx % width;
+
+        if (z > 0) f(idx - height * width, 0);
+        if (z < depth - 1) f(idx + height * width, 0);
+        if (y > 0) f(idx - width, 1);
+        if (y < height - 1) f(idx + width, 1);
+        if (x > 0) f(idx - 1, 2);
+        if (x < width - 1) f(idx + 1, 2);
+    }
+
+    /**
+     * Turns the faces between two components into internal faces by
+     * scanning the members of `small` for neighbors inside `large`.
+     */
+    void merge_shared_faces(int small, int large, ComponentStats &merged) {
+        int i = small;
+        do {
+            int idx = visited[i];
+            for_each_neighbor(idx, [&](int nidx, int axis) {
+                if (uf.find_index(nidx) == large) {
+                    // the face was on the boundary of both sides
+                    merged.internal_faces[axis]++;
+                    merged.boundary_sum -= 2.0 * weight(idx, nidx);
+                    merged.boundary_count -= 2;
+                }
+            });
+            i = next[i];
+        } while (i != small);
+    }
+
+    /**
+     * Joins two circular lists of parentless hypotheses.
+     */
+    int splice_tops(int a, int b) {
+        if (a < 0) {
+            return b;
+        }
+        if (b >= 0) {
+            std::swap(top_next[a - first_segment], top_next[b - first_segment]);
+        }
+        return a;
+    }
+
+    /**
+     * Physical area of the faces between the component and its complement.
+     */
+    float surface_area(int root, int size) const {
+        const Spacing &s = params.spacing;
+        float face_area[3] = {s[1] * s[2], s[0] * s[2], s[0] * s[1]};
+        float area = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            area += 2 * (size - stats[root].internal_faces[i]) * face_area[i];
+        }
+        return area;
+    }
+
+    void emit(int root, int size, bool filter) {
+        const Spacing &s = params.spacing;
+        float volume = size * s[0] * s[1] * s[2];
+        float area = surface_area(root, size);
+
+        if (filter) {
+            if (volume <= params.min_num_pixels || volume >= params.max_num_pixels) {
+                return;
+            }
+            // voxelized shapes have staircase boundaries, so their sphericity
+            // stays well below 1 even for digital balls
+            const float cbrt_pi = 1.46459189f;
+            float sphericity = cbrt_pi * std::pow(6.0f * volume, 2.0f / 3.0f) / area;
+            if (sphericity < params.min_sphericity) {
+                return;
+            }
+        }
+
+        std::vector<int> voxels;
+        voxels.reserve(size);
+        int i = root;
+        do {
+            voxels.push_back(visited[i]);
+            i = next[i];
+        } while (i != root);
+
+        const ComponentStats &root_stats = stats[root];
+        Segment segment = Segment::from_visited(voxels, depth, height, width, s);
+        segment.area = area;
+        segment.score = root_stats.boundary_count > 0
+            ? static_cast<float>(root_stats.boundary_sum / root_stats.boundary_count)
+            : 0.0f;
+
+        // the new hypothesis contains every parentless one of its component
+        int index = segments.size();
+        int h = top[root];
+        if (h >= 0) {
+            do {
+                segments[h].parent = index;
+                h = top_next[h - first_segment];
+            } while (h != top[root]);
+        }
+        top[root] = index;
+        top_next.push_back(index);
+
+        segments.push_back(segment);
+        num_segments++;
+    }
+};
+
+
+/**
+ * Expands the parent links of the hypotheses into the list of overlapping
+ * (ancestor, descendant) pairs, shaped (num_conflicts, 2).
+ * Parents are emitted after their children, so any other link means the
+ * list was filtered or reordered and is rejected.
+ * Time complexity: O(hypotheses x hierarchy depth)
+ */
+inline nb::ndarray<nb::numpy, int> compute_conflict_edges(
+    const std::vector<Segment> &segments
+) {
+    int num_segments = static_cast<int>(segments.size());
+    for (int i = 0; i < num_segments; i++) {
+        int p = segments[i].parent;
+        if (p >= 0 && (p <= i || p >= num_segments)) {
+            throw std::invalid_argument("segment parents must index later hypotheses of the same list");
+        }
+    }
+
+    std::vector<int> edges;
+    for (int i = 0; i < num_segments; i++) {
+        for (int p = segments[i].parent; p >= 0; p = segments[p].parent) {
+            edges.push_back(p);
+            edges.push_back(i);
+        }
+    }
+    size_t num_edges = edges.size() / 2;
+    return to_ndarray(std::move(edges), {num_edges, 2});
+}
+
+#endif // HIERARCHY_H
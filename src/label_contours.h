@@ -0,0 +1,182 @@
+#ifndef LABEL_CONTOURS_H
+#define LABEL_CONTOURS_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "parallel.h"
+#include "volume_view.h"
+
+namespace nb = nanobind;
+
+/**
+ * Raw description of one label volume that can be read without the GIL.
+ */
+struct LabelMap {
+    const void *data;
+    int bits;            // width of the label dtype
+    int64_t strides[3];  // in elements
+    bool contiguous;
+};
+
+
+/**
+ * Adds the boundaries and foreground of one label plane z to the outputs.
+ *
+ * A voxel is on a boundary when any face-adjacent voxel has a different
+ * label, background included. Missing neighbors outside the volume are
+ * replaced by the voxel's own row, which never differs, so the inner loop
+ * is a branch-free comparison of contiguous rows that compilers vectorize.
+ */
+template <typename L, bool Contiguous>
+void accumulate_label_plane(
+    const LabelMap &map,
+    int depth,
+    int height,
+    int width,
+    int z,
+    float scale,
+    uint8_t *foreground,
+    float *contours
+) {
+    const L *data = static_cast<const L *>(map.data);
+    const int64_t sz = map.strides[0];
+    const int64_t sy = map.strides[1];
+    const int64_t sx = Contiguous ? 1 : map.strides[2];
+
+    for (int y = 0; y < height; y++) {
+        const L *row = data + z * sz + y * sy;
+        const L *north = y > 0 ? row - sy : row;
+        const L *south = y < height - 1 ? row + sy : row;
+        const L *below = z > 0 ? row - sz : row;
+        const L *above = z < depth - 1 ? row + sz : row;
+
+        size_t offset = (static_cast<size_t>(z) * height + y) * width;
+        uint8_t *fg_row = foreground + offset;
+        float *ctr_row = contours + offset;
+
+        for (int x = 0; x < width; x++) {
+            int64_t i = x * sx;
+            L value = row[i];
+            L left = row[x > 0 ? i - sx : i];
+            L right = row[x < width - 1 ? i + sx : i];
+            bool boundary = (left != value) | (right != value) |
+                            (north[i] != value) | (south[i] != value) |
+                            (below[i] != value) | (above[i] != value);
+            fg_row[x] |= value != 0;
+            ctr_row[x] += boundary ? scale : 0.0f;
+        }
+    }
+}
+
+
+/**
+ * Dispatches a plane of one label map on its dtype width and layout.
+ */
+inline void accumulate_label_plane(
+    const LabelMap &map,
+    int depth,
+    int height,
+    int width,
+    int z,
+    float scale,
+    uint8_t *foreground,
+    float *contours
+) {
+    auto accumulate = [&](auto zero) {
+        using L = decltype(zero);
+        if (map.contiguous) {
+            accumulate_label_plane<L, true>(map, depth, height, width, z, scale, foreground, contours);
+        } else {
+            accumulate_label_plane<L, false>(map, depth, height, width, z, scale, foreground, contours);
+        }
+    };
+    switch (map.bits) {
+    case 8: accumulate(uint8_t(0)); break;
+    case 16: accumulate(uint16_t(0)); break;
+    case 32: accumulate(uint32_t(0)); break;
+    case 64: accumulate(uint64_t(0)); break;
+    }
+}
+
+
+/**
+ * Builds the foreground and contour maps of an ensemble of label images,
+ * e.g. instance segmentations of one frame by several methods.
+ * The foreground is the union of the labeled voxels, and contours are the
+ * fraction of label images in which each voxel lies on a boundary, so
+ * both feed compute_segmentation_hypotheses directly.
+ *
+ * Labels may have any integer dtype, each its own, and are read in place.
+ * All label images are accumulated in one pass, in parallel over z-planes.
+ * Returns the (foreground, contours) arrays.
+ */
+inline nb::tuple labels_to_contours(
+    const std::vector<nb::ndarray<nb::ro>> &labels,
+    int num_threads
+) {
+    if (labels.empty()) {
+        throw std::invalid_argument("labels must hold at least one label image");
+    }
+    for (const auto &label : labels) {
+        if (label.ndim() != 3) {
+            throw std::invalid_argument("label images must be 3D arrays");
+        }
+        for (size_t i = 0; i < 3; i++) {
+            if (label.shape(i) != labels[0].shape(i)) {
+                throw std::invalid_argument("label images must have the same shape");
+            }
+        }
+    }
+
+    std::vector<LabelMap> maps;
+    maps.reserve(labels.size());
+    for (const auto &label : labels) {
+        auto dtype = label.dtype();
+        bool integral = dtype.code == static_cast<uint8_t>(nb::dlpack::dtype_code::Int) ||
+                        dtype.code == static_cast<uint8_t>(nb::dlpack::dtype_code::UInt) ||
+                        dtype.code == static_cast<uint8_t>(nb::dlpack::dtype_code::Bool);
+        if (!integral || dtype.lanes != 1 ||
+            (dtype.bits != 8 && dtype.bits != 16 && dtype.bits != 32 && dtype.bits != 64)) {
+            throw std::invalid_argument("label images must be boolean or integer arrays");
+        }
+        // only equality and nonzero matter, so labels are read as unsigned
+        maps.push_back(LabelMap{
+            label.data(), dtype.bits,
+            {label.stride(0), label.stride(1), label.stride(2)},
+            is_c_contiguous(label)
+        });
+    }
+
+    int depth = labels[0].shape(0);
+    int height = labels[0].shape(1);
+    int width = labels[0].shape(2);
+    size_t size = static_cast<size_t>(depth) * height * width;
+
+    std::vector<uint8_t> foreground(size, 0);
+    std::vector<float> contours(size, 0.0f);
+    {
+        nb::gil_scoped_release release;
+
+        float scale = 1.0f / maps.size();
+        parallel_for(depth, [&](size_t z) {
+            for (const LabelMap &map : maps) {
+                accumulate_label_plane(
+                    map, depth, height, width, static_cast<int>(z), scale,
+                    foreground.data(), contours.data()
+                );
+            }
+        }, num_threads);
+    }
+
+    size_t d = depth, h = height, w = width;
+    return nb::make_tuple(
+        to_bool_ndarray(std::move(foreground), {d, h, w}),
+        to_ndarray(std::move(contours), {d, h, w})
+    );
+}
+
+#endif // LABEL_CONTOURS_H
@@ -0,0 +1,220 @@
+#ifndef LINEAR_ASSIGNMENT_H
+#define LINEAR_ASSIGNMENT_H
+
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "linking.h"
+#include "parallel.h"
+
+namespace nb = nanobind;
+
+/**
+ * Sparse linear assignment by shortest augmenting paths, i.e. the
+ * augmentation phase of Jonker-Volgenant on a sparse cost list.
+ *
+ * Every row owns a private dummy column of cost zero, so rows can always
+ * stay unassigned and only negative costs are worth assigning. Each row
+ * is inserted with one Dijkstra over reduced costs c(r, k) - u(r) - v(k),
+ * where the column duals v are updated after every augmentation and the
+ * row duals u follow from complementary slackness.
+ * Time complexity: O(rows x edges log columns) worst case, near linear on
+ * the sparse, mostly unambiguous candidate lists of tracking.
+ */
+class SparseAssignment {
+private:
+    struct Entry {
+        int col;
+        double cost;
+        int id;  // caller's edge id, -1 for dummies
+    };
+
+    int num_rows;
+    int num_cols;                       // real columns, dummies follow
+    std::vector<std::vector<Entry>> rows;
+
+public:
+    SparseAssignment(int num_rows, int num_cols)
+        : num_rows(num_rows), num_cols(num_cols), rows(num_rows) {
+        for (int r = 0; r < num_rows; r++) {
+            rows[r].push_back(Entry{num_cols + r, 0.0, -1});
+        }
+    }
+
+    void add_edge(int row, int col, double cost, int id) {
+        rows[row].push_back(Entry{col, cost, id});
+    }
+
+    /**
+     * Solves the assignment and returns the id of the edge chosen by
+     * every row, -1 for rows left unassigned.
+     */
+    std::vector<int> solve() const {
+        const double infinity = std::numeric_limits<double>::infinity();
+        int total_cols = num_cols + num_rows;
+
+        std::vector<double> v(total_cols, 0.0);
+        std::vector<int> col_owner(total_cols, -1);
+        std::vector<const Entry *> row_entry(num_rows, nullptr);
+
+        std::vector<double> dist(total_cols, infinity);
+        std::vector<char> done(total_cols, 0);
+        std::vector<int> pred_row(total_cols, -1);
+        std::vector<const Entry *> pred_entry(total_cols, nullptr);
+        std::vector<int> touched;
+
+        using Item = std::pair<double, int>;
+        for (int i = 0; i < num_rows; i++) {
+            std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+            auto relax = [&](int r, const Entry &e, double base) {
+                if (done[e.col]) {
+                    return;
+                }
+                double d = base + e.cost - v[e.col];
+                if (d < dist[e.col]) {
+                    if (dist[e.col] == infinity) {
+                        touched.push_back(e.col);
+                    }
+                    dist[e.col] = d;
+                    pred_row[e.col] = r;
+                    pred_entry[e.col] = &e;
+                    heap.emplace(d, e.col);
+                }
+            };
+
+            for (const Entry &e : rows[i]) {
+                relax(i, e, 0.0);
+            }
+
+            int sink = -1;
+            double delta = 0.0;
+            std::vector<int> finalized;
+            while (!heap.empty()) {
+                auto [d, j] = heap.top();
+                heap.pop();
+                if (done[j] || d > dist[j]) {
+                    continue;
+                }
+                done[j] = 1;
+                finalized.push_back(j);
+                if (col_owner[j] < 0) {
+                    sink = j;
+                    delta = d;
+                    break;
+                }
+                int r = col_owner[j];
+                double u_r = row_entry[r]->cost - v[j];
+                for (const Entry &e : rows[r]) {
+                    relax(r, e, d - u_r);
+                }
+            }
+
+            // the private dummy keeps every row assignable
+            for (int j : finalized) {
+                v[j] += dist[j] - delta;
+            }
+
+            for (int j = sink;;) {
+                int r = pred_row[j];
+                const Entry *previous = row_entry[r];
+                row_entry[r] = pred_entry[j];
+                col_owner[j] = r;
+                if (r == i) {
+                    break;
+                }
+                j = previous->col;
+            }
+
+            for (int j : touched) {
+                dist[j] = infinity;
+                done[j] = 0;
+            }
+            touched.clear();
+        }
+
+        std::vector<int> assignment(num_rows, -1);
+        for (int r = 0; r < num_rows; r++) {
+            assignment[r] = row_entry[r]->id;
+        }
+        return assignment;
+    }
+};
+
+
+/**
+ * One-to-one frame-to-frame linking, for datasets without divisions.
+ *
+ * Every node keeps at most one parent and one child. The solution
+ * maximizes the selected link weights plus `appear_weight` and
+ * `disappear_weight` for every unlinked node of frame t + 1 and t, with
+ * the same sign convention as min_cost_flow_tracking. Frame pairs are
+ * solved independently, in parallel.
+ *
+ * Returns (parent of every node or -1, selected link ids).
+ */
+inline nb::tuple linear_assignment_tracking(
+    const nb::ndarray<const int, nb::shape<-1>, nb::c_contig> &node_times,
+    const IndexPairs &links,
+    const Values &link_weights,
+    float appear_weight,
+    float disappear_weight,
+    int num_threads
+) {
+    int num_nodes = static_cast<int>(node_times.shape(0));
+    size_t num_links = links.shape(0);
+    if (link_weights.shape(0) != num_links) {
+        throw std::invalid_argument("links and link_weights must have the same length");
+    }
+    check_indices(links.data(), 2 * num_links, num_nodes, "links");
+
+    const int *link_data = links.data();
+    const float *weights = link_weights.data();
+    std::vector<std::vector<int>> groups = group_links_by_frame(node_times.data(), link_data, num_links);
+
+    std::vector<char> selected(num_links, 0);
+    {
+        nb::gil_scoped_release release;
+
+        parallel_for(groups.size(), [&](size_t g) {
+            const std::vector<int> &group = groups[g];
+            LocalNodes local(link_data, group);
+
+            // a link replaces one appearance and one disappearance
+            SparseAssignment assignment(local.num_sources, local.num_targets);
+            for (size_t k = 0; k < group.size(); k++) {
+                double gain = static_cast<double>(weights[group[k]]) - appear_weight - disappear_weight;
+                if (gain > 0.0) {
+                    assignment.add_edge(local.source_of_link[k], local.target_of_link[k], -gain, group[k]);
+                }
+            }
+            for (int id : assignment.solve()) {
+                if (id >= 0) {
+                    selected[id] = 1;
+                }
+            }
+        }, num_threads);
+    }
+
+    std::vector<int> parents(num_nodes, -1);
+    std::vector<int> selected_links;
+    for (size_t e = 0; e < num_links; e++) {
+        if (selected[e]) {
+            parents[link_data[2 * e + 1]] = link_data[2 * e];
+            selected_links.push_back(static_cast<int>(e));
+        }
+    }
+
+    size_t num_selected = selected_links.size();
+    return nb::make_tuple(
+        to_ndarray(std::move(parents), {static_cast<size_t>(num_nodes)}),
+        to_ndarray(std::move(selected_links), {num_selected})
+    );
+}
+
+#endif // LINEAR_ASSIGNMENT_H
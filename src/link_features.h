@@ -0,0 +1,166 @@
+#ifndef LINK_FEATURES_H
+#define LINK_FEATURES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "parallel.h"
+
+namespace nb = nanobind;
+
+using Centroids = nb::ndarray<const float, nb::shape<-1, 3>, nb::c_contig>;
+using Counts = nb::ndarray<const int64_t, nb::shape<-1>, nb::c_contig>;
+
+/**
+ * Rows of the link feature matrix.
+ */
+enum LinkFeature {
+    LINK_DISTANCE = 0,   // euclidean distance between centroids
+    LINK_IOU,            // intersection over union, NaN without intersections
+    LINK_SIZE_RATIO,     // smaller size over larger size
+    LINK_INTENSITY_DIFF, // absolute intensity difference, NaN without intensities
+    NUM_LINK_FEATURES,
+};
+
+
+/**
+ * Computes the (NUM_LINK_FEATURES, K) feature matrix of K candidate links
+ * (source in frame t, target in frame t + 1) from the attribute tables of
+ * both frames. IoU uses `intersections` from compute_overlaps, so sizes
+ * must then be voxel counts such as Segment.num_pixels.
+ *
+ * Pairs are processed in blocks: attributes are first gathered into
+ * contiguous columns, then every feature is a loop over columns whose
+ * only conditions are selects, which compilers vectorize. Missing inputs
+ * are tested once per block. Blocks run in parallel.
+ */
+inline nb::ndarray<nb::numpy, float> compute_link_features(
+    const IndexPairs &pairs,
+    const Centroids &source_centroids,
+    const Values &source_sizes,
+    const Centroids &target_centroids,
+    const Values &target_sizes,
+    std::optional<Counts> intersections,
+    std::optional<Values> source_intensities,
+    std::optional<Values> target_intensities,
+    int num_threads
+) {
+    size_t num_pairs = pairs.shape(0);
+    int num_sources = static_cast<int>(source_centroids.shape(0));
+    int num_targets = static_cast<int>(target_centroids.shape(0));
+    if (source_sizes.shape(0) != static_cast<size_t>(num_sources) ||
+        target_sizes.shape(0) != static_cast<size_t>(num_targets)) {
+        throw std::invalid_argument("sizes must match the number of centroids");
+    }
+    if (intersections && intersections->shape(0) != num_pairs) {
+        throw std::invalid_argument("intersections must match the number of pairs");
+    }
+    if (source_intensities.has_value() != target_intensities.has_value()) {
+        throw std::invalid_argument("intensities must be given for both frames");
+    }
+    if (source_intensities && (source_intensities->shape(0) != static_cast<size_t>(num_sources) ||
+                               target_intensities->shape(0) != static_cast<size_t>(num_targets))) {
+        throw std::invalid_argument("intensities must match the number of centroids");
+    }
+
+    const int *pair_data = pairs.data();
+    for (size_t k = 0; k < num_pairs; k++) {
+        if (pair_data[2 * k] < 0 || pair_data[2 * k] >= num_sources ||
+            pair_data[2 * k + 1] < 0 || pair_data[2 * k + 1] >= num_targets) {
+            throw std::out_of_range("pairs must index the source and target tables");
+        }
+    }
+
+    const float *src_c = source_centroids.data();
+    const float *dst_c = target_centroids.data();
+    const float *src_s = source_sizes.data();
+    const float *dst_s = target_sizes.data();
+    const int64_t *inter = intersections ? intersections->data() : nullptr;
+    const float *src_i = source_intensities ? source_intensities->data() : nullptr;
+    const float *dst_i = target_intensities ? target_intensities->data() : nullptr;
+
+    std::vector<float> features(NUM_LINK_FEATURES * num_pairs);
+    {
+        nb::gil_scoped_release release;
+
+        const size_t block = 4096;
+        size_t num_blocks = (num_pairs + block - 1) / block;
+        parallel_for(num_blocks, [&](size_t b) {
+            size_t start = b * block;
+            size_t n = std::min(block, num_pairs - start);
+            const int *p = pair_data + 2 * start;
+
+            // gathered columns of this block
+            std::vector<float> columns(8 * n);
+            float *dz = columns.data();
+            float *dy = dz + n;
+            float *dx = dy + n;
+            float *size_a = dx + n;
+            float *size_b = size_a + n;
+            float *value_a = size_b + n;
+            float *value_b = value_a + n;
+            float *shared = value_b + n;
+            for (size_t k = 0; k < n; k++) {
+                int s = p[2 * k];
+                int t = p[2 * k + 1];
+                dz[k] = src_c[3 * s] - dst_c[3 * t];
+                dy[k] = src_c[3 * s + 1] - dst_c[3 * t + 1];
+                dx[k] = src_c[3 * s + 2] - dst_c[3 * t + 2];
+                size_a[k] = src_s[s];
+                size_b[k] = dst_s[t];
+            }
+            // optional columns are gathered by their own loops, so no loop
+            // tests per pair whether they are given
+            if (src_i) {
+                for (size_t k = 0; k < n; k++) {
+                    value_a[k] = src_i[p[2 * k]];
+                    value_b[k] = dst_i[p[2 * k + 1]];
+                }
+            }
+            if (inter) {
+                for (size_t k = 0; k < n; k++) {
+                    shared[k] = static_cast<float>(inter[start + k]);
+                }
+            }
+
+            float *distance = features.data() + LINK_DISTANCE * num_pairs + start;
+            float *iou = features.data() + LINK_IOU * num_pairs + start;
+            float *ratio = features.data() + LINK_SIZE_RATIO * num_pairs + start;
+            float *diff = features.data() + LINK_INTENSITY_DIFF * num_pairs + start;
+
+            for (size_t k = 0; k < n; k++) {
+                distance[k] = std::sqrt(dz[k] * dz[k] + dy[k] * dy[k] + dx[k] * dx[k]);
+            }
+            for (size_t k = 0; k < n; k++) {
+                float hi = std::max(size_a[k], size_b[k]);
+                ratio[k] = hi > 0.0f ? std::min(size_a[k], size_b[k]) / hi : 0.0f;
+            }
+            if (inter) {
+                for (size_t k = 0; k < n; k++) {
+                    float total = size_a[k] + size_b[k] - shared[k];
+                    iou[k] = total > 0.0f ? shared[k] / total : 0.0f;
+                }
+            } else {
+                std::fill(iou, iou + n, std::numeric_limits<float>::quiet_NaN());
+            }
+            if (src_i) {
+                for (size_t k = 0; k < n; k++) {
+                    diff[k] = std::abs(value_a[k] - value_b[k]);
+                }
+            } else {
+                std::fill(diff, diff + n, std::numeric_limits<float>::quiet_NaN());
+            }
+        }, num_threads);
+    }
+
+    return to_ndarray(std::move(features), {static_cast<size_t>(NUM_LINK_FEATURES), num_pairs});
+}
+
+#endif // LINK_FEATURES_H
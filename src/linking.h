@@ -0,0 +1,75 @@
+#ifndef LINKING_H
+#define LINKING_H
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Throws if any index falls outside [0, num_nodes).
+ */
+inline void check_indices(const int *indices, size_t count, int num_nodes, const char *name) {
+    for (size_t i = 0; i < count; i++) {
+        if (indices[i] < 0 || indices[i] >= num_nodes) {
+            throw std::out_of_range(std::string(name) + " must index the nodes");
+        }
+    }
+}
+
+
+/**
+ * Splits the link candidates by the frame of their source so every
+ * frame pair can be solved independently. Links must go from frame t
+ * to frame t + 1. Groups are returned in increasing frame order.
+ */
+inline std::vector<std::vector<int>> group_links_by_frame(
+    const int *node_times,
+    const int *links,
+    size_t num_links
+) {
+    std::map<int, std::vector<int>> groups;
+    for (size_t e = 0; e < num_links; e++) {
+        int t = node_times[links[2 * e]];
+        if (node_times[links[2 * e + 1]] != t + 1) {
+            throw std::invalid_argument("links must connect frame t to frame t + 1");
+        }
+        groups[t].push_back(static_cast<int>(e));
+    }
+
+    std::vector<std::vector<int>> result;
+    result.reserve(groups.size());
+    for (auto &group : groups) {
+        result.push_back(std::move(group.second));
+    }
+    return result;
+}
+
+
+/**
+ * Maps the nodes used by a subset of links to dense local indices,
+ * separately for sources and targets.
+ */
+struct LocalNodes {
+    std::vector<int> source_of_link;  // local source index per link in the group
+    std::vector<int> target_of_link;  // local target index per link in the group
+    int num_sources = 0;
+    int num_targets = 0;
+
+    LocalNodes(const int *links, const std::vector<int> &group) {
+        std::map<int, int> sources, targets;
+        source_of_link.reserve(group.size());
+        target_of_link.reserve(group.size());
+        for (int e : group) {
+            auto s = sources.emplace(links[2 * e], static_cast<int>(sources.size())).first;
+            auto t = targets.emplace(links[2 * e + 1], static_cast<int>(targets.size())).first;
+            source_of_link.push_back(s->second);
+            target_of_link.push_back(t->second);
+        }
+        num_sources = static_cast<int>(sources.size());
+        num_targets = static_cast<int>(targets.size());
+    }
+};
+
+#endif // LINKING_H
@@ -0,0 +1,325 @@
+#ifndef MIN_COST_FLOW_H
+#define MIN_COST_FLOW_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "linking.h"
+#include "parallel.h"
+
+namespace nb = nanobind;
+
+/**
+ * Min-cost flow by successive shortest paths (primal-dual).
+ *
+ * Each phase runs Dijkstra on reduced costs, updates the node potentials
+ * and then pushes as many units as possible along zero reduced cost paths,
+ * so a phase serves every shortest path of the same length. Costs are
+ * integers, which keeps the zero reduced cost test exact. Negative arc
+ * costs are allowed as long as there is no negative cycle.
+ */
+class MinCostFlow {
+private:
+    struct Arc {
+        int to;
+        int rev;     // index of the reverse arc in graph[to]
+        int cap;
+        int64_t cost;
+    };
+
+    static constexpr int64_t infinity = std::numeric_limits<int64_t>::max() / 4;
+
+    std::vector<std::vector<Arc>> graph;
+    std::vector<int64_t> potential;
+    std::vector<size_t> current;  // next arc to try per node while augmenting
+    std::vector<char> on_path;
+
+public:
+    explicit MinCostFlow(int num_nodes) : graph(num_nodes) {}
+
+    /**
+     * Adds an arc and returns its handle (from, position) for flow().
+     */
+    std::pair<int, int> add_arc(int from, int to, int cap, int64_t cost) {
+        int position = static_cast<int>(graph[from].size());
+        graph[from].push_back(Arc{to, static_cast<int>(graph[to].size()), cap, cost});
+        graph[to].push_back(Arc{from, position, 0, -cost});
+        return {from, position};
+    }
+
+    /**
+     * Flow currently carried by an arc.
+     */
+    int flow(std::pair<int, int> arc) const {
+        const Arc &a = graph[arc.first][arc.second];
+        return graph[a.to][a.rev].cap;
+    }
+
+    /**
+     * Sends up to max_flow units from s to t at minimum cost and returns
+     * the amount sent.
+     */
+    int solve(int s, int t, int max_flow) {
+        init_potentials(s);
+        int sent = 0;
+        while (sent < max_flow && shortest_paths(s, t)) {
+            current.assign(graph.size(), 0);
+            on_path.assign(graph.size(), 0);
+            while (sent < max_flow) {
+                int pushed = augment(s, t, max_flow - sent);
+                if (pushed == 0) {
+                    break;
+                }
+                sent += pushed;
+            }
+        }
+        return sent;
+    }
+
+private:
+    int64_t reduced_cost(int from, const Arc &arc) const {
+        return arc.cost + potential[from] - potential[arc.to];
+    }
+
+    /**
+     * Bellman-Ford (queue based) distances, so negative arcs start with
+     * non-negative reduced costs.
+     */
+    void init_potentials(int s) {
+        potential.assign(graph.size(), infinity);
+        std::vector<char> queued(graph.size(), 0);
+        std::queue<int> queue;
+        potential[s] = 0;
+        queue.push(s);
+        while (!queue.empty()) {
+            int u = queue.front();
+            queue.pop();
+            queued[u] = 0;
+            for (const Arc &arc : graph[u]) {
+                if (arc.cap > 0 && potential[u] + arc.cost < potential[arc.to]) {
+                    potential[arc.to] = potential[u] + arc.cost;
+                    if (!queued[arc.to]) {
+                        queued[arc.to] = 1;
+                        queue.push(arc.to);
+                    }
+                }
+            }
+        }
+        for (int64_t &p : potential) {
+            if (p == infinity) {
+                p = 0;
+            }
+        }
+    }
+
+    /**
+     * Dijkstra on reduced costs followed by the potential update
+     * p(v) += min(d(v), d(t)), which keeps every residual reduced cost
+     * non-negative and zeroes it along the shortest paths to t.
+     * Returns false if t is unreachable.
+     */
+    bool shortest_paths(int s, int t) {
+        std::vector<int64_t> dist(graph.size(), infinity);
+        using Entry = std::pair<int64_t, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        dist[s] = 0;
+        heap.emplace(0, s);
+        while (!heap.empty()) {
+            auto [d, u] = heap.top();
+            heap.pop();
+            if (d > dist[u]) {
+                continue;
+            }
+            if (u == t) {
+                break;
+            }
+            for (const Arc &arc : graph[u]) {
+                if (arc.cap > 0) {
+                    int64_t nd = d + reduced_cost(u, arc);
+                    if (nd < dist[arc.to]) {
+                        dist[arc.to] = nd;
+                        heap.emplace(nd, arc.to);
+                    }
+                }
+            }
+        }
+        if (dist[t] == infinity) {
+            return false;
+        }
+        for (size_t v = 0; v < graph.size(); v++) {
+            potential[v] += std::min(dist[v], dist[t]);
+        }
+        return true;
+    }
+
+    /**
+     * Pushes flow along one path of zero reduced cost arcs, found by an
+     * iterative depth-first search. Exhausted arcs are skipped for the rest
+     * of the phase through `current`.
+     */
+    int augment(int s, int t, int limit) {
+        std::vector<int> path = {s};
+        on_path[s] = 1;
+        while (!path.empty()) {
+            int u = path.back();
+            if (u == t) {
+                int pushed = limit;
+                for (size_t k = 0; k + 1 < path.size(); k++) {
+                    pushed = std::min(pushed, graph[path[k]][current[path[k]]].cap);
+                }
+                for (size_t k = 0; k + 1 < path.size(); k++) {
+                    Arc &arc = graph[path[k]][current[path[k]]];
+                    arc.cap -= pushed;
+                    graph[arc.to][arc.rev].cap += pushed;
+                }
+                for (int v : path) {
+                    on_path[v] = 0;
+                }
+                return pushed;
+            }
+
+            bool advanced = false;
+            for (size_t &i = current[u]; i < graph[u].size(); i++) {
+                const Arc &arc = graph[u][i];
+                if (arc.cap > 0 && !on_path[arc.to] && reduced_cost(u, arc) == 0) {
+                    on_path[arc.to] = 1;
+                    path.push_back(arc.to);
+                    advanced = true;
+                    break;
+                }
+            }
+            if (!advanced) {
+                // dead end, retreat and skip the arc that led here
+                on_path[u] = 0;
+                path.pop_back();
+                if (!path.empty()) {
+                    current[path.back()]++;
+                }
+            }
+        }
+        return 0;
+    }
+};
+
+
+/**
+ * Frame-to-frame association of a fixed set of hypotheses by min-cost flow.
+ *
+ * Every node is kept. A node of frame t + 1 either takes one incoming link
+ * or appears, and a node of frame t either takes up to `max_children`
+ * outgoing links or disappears. The solution maximizes the sum of the
+ * selected link weights plus `appear_weight`, `disappear_weight` and
+ * `division_weight` for every appearance, disappearance and extra child,
+ * with the same sign convention as greedy_tracking. Weights are resolved
+ * to 1e-6. Flow costs must be convex in the number of children, so with
+ * `max_children` above 1, `division_weight` may not exceed the
+ * `-disappear_weight` a first child saves. Frames are independent once the
+ * nodes are fixed, so each frame pair is solved on its own network, in
+ * parallel.
+ *
+ * Returns (parent of every node or -1, selected link ids).
+ */
+inline nb::tuple min_cost_flow_tracking(
+    const nb::ndarray<const int, nb::shape<-1>, nb::c_contig> &node_times,
+    const IndexPairs &links,
+    const Values &link_weights,
+    float appear_weight,
+    float disappear_weight,
+    float division_weight,
+    int max_children,
+    int num_threads
+) {
+    int num_nodes = static_cast<int>(node_times.shape(0));
+    size_t num_links = links.shape(0);
+    if (link_weights.shape(0) != num_links) {
+        throw std::invalid_argument("links and link_weights must have the same length");
+    }
+    check_indices(links.data(), 2 * num_links, num_nodes, "links");
+    if (max_children < 1) {
+        throw std::invalid_argument("max_children must be at least 1");
+    }
+
+    auto to_cost = [](float weight) {
+        return static_cast<int64_t>(std::llround(-static_cast<double>(weight) * 1e6));
+    };
+    // a first child saves the disappearance and later ones pay the division;
+    // successive shortest paths take the cheaper arc first, so the first
+    // child may not cost more than the others
+    int64_t first_child = -to_cost(disappear_weight);
+    int64_t extra_child = to_cost(division_weight);
+    if (max_children > 1 && extra_child < first_child) {
+        throw std::invalid_argument("division_weight must not exceed -disappear_weight");
+    }
+
+    const int *link_data = links.data();
+    const float *weights = link_weights.data();
+    std::vector<std::vector<int>> groups = group_links_by_frame(node_times.data(), link_data, num_links);
+
+    std::vector<char> selected(num_links, 0);
+    {
+        nb::gil_scoped_release release;
+
+        parallel_for(groups.size(), [&](size_t g) {
+            const std::vector<int> &group = groups[g];
+            LocalNodes local(link_data, group);
+
+            // s, t, sources, targets
+            int s = 0, t = 1;
+            int first_source = 2;
+            int first_target = first_source + local.num_sources;
+            MinCostFlow flow(first_target + local.num_targets);
+
+            for (int i = 0; i < local.num_sources; i++) {
+                flow.add_arc(s, first_source + i, 1, first_child);
+                if (max_children > 1) {
+                    flow.add_arc(s, first_source + i, max_children - 1, extra_child);
+                }
+            }
+            for (int j = 0; j < local.num_targets; j++) {
+                flow.add_arc(s, first_target + j, 1, to_cost(appear_weight));
+                flow.add_arc(first_target + j, t, 1, 0);
+            }
+            std::vector<std::pair<int, int>> arcs;
+            arcs.reserve(group.size());
+            for (size_t k = 0; k < group.size(); k++) {
+                arcs.push_back(flow.add_arc(
+                    first_source + local.source_of_link[k],
+                    first_target + local.target_of_link[k],
+                    1, to_cost(weights[group[k]])
+                ));
+            }
+
+            // every target is covered, by a link or by an appearance
+            flow.solve(s, t, local.num_targets);
+            for (size_t k = 0; k < group.size(); k++) {
+                selected[group[k]] = flow.flow(arcs[k]) > 0;
+            }
+        }, num_threads);
+    }
+
+    std::vector<int> parents(num_nodes, -1);
+    std::vector<int> selected_links;
+    for (size_t e = 0; e < num_links; e++) {
+        if (selected[e]) {
+            parents[link_data[2 * e + 1]] = link_data[2 * e];
+            selected_links.push_back(static_cast<int>(e));
+        }
+    }
+
+    size_t num_selected = selected_links.size();
+    return nb::make_tuple(
+        to_ndarray(std::move(parents), {static_cast<size_t>(num_nodes)}),
+        to_ndarray(std::move(selected_links), {num_selected})
+    );
+}
+
+#endif // MIN_COST_FLOW_H
@@ -0,0 +1,259 @@
+#ifndef OVERLAP_H
+#define OVERLAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "parallel.h"
+#include "segment.h"
+
+namespace nb = nanobind;
+
+/**
+ * Raw view of a segment mask that can be read without holding the GIL.
+ */
+struct MaskView {
+    const bool *data;
+    int lo[3];  // inclusive bbox start along (z, y, x)
+    int hi[3];  // inclusive bbox end along (z, y, x)
+    int num_pixels;
+
+    static MaskView from_segment(const Segment &segment) {
+        MaskView view;
+        view.data = segment.mask.data();
+        // the origin comes from the bbox, which Python-built segments set in full
+        for (int i = 0; i < 3; i++) {
+            view.lo[i] = segment.bbox.data()[i * segment.bbox.stride(0)];
+        }
+        for (int i = 0; i < 3; i++) {
+            view.hi[i] = view.lo[i] + static_cast<int>(segment.mask.shape(i)) - 1;
+        }
+        view.num_pixels = segment.num_pixels;
+        return view;
+    }
+
+    int height() const {
+        return hi[1] - lo[1] + 1;
+    }
+
+    int width() const {
+        return hi[2] - lo[2] + 1;
+    }
+};
+
+
+/**
+ * Counts the positions where both boolean runs are true, eight bytes at a time.
+ */
+inline int64_t count_and(const bool *a, const bool *b, size_t n) {
+    int64_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word_a, word_b;
+        std::memcpy(&word_a, a + i, 8);
+        std::memcpy(&word_b, b + i, 8);
+        // bools are 0/1 bytes, so the byte sum of the AND is its popcount
+        count += ((word_a & word_b) * 0x0101010101010101ULL) >> 56;
+    }
+    for (; i < n; i++) {
+        count += a[i] & b[i];
+    }
+    return count;
+}
+
+
+/**
+ * Number of voxels shared by two masks, restricted to their bbox intersection.
+ * Time complexity: O(bbox intersection volume)
+ */
+inline int64_t mask_intersection(const MaskView &a, const MaskView &b) {
+    int lo[3], hi[3];
+    for (int i = 0; i < 3; i++) {
+        lo[i] = std::max(a.lo[i], b.lo[i]);
+        hi[i] = std::min(a.hi[i], b.hi[i]);
+        if (lo[i] > hi[i]) {
+            return 0;
+        }
+    }
+
+    size_t run = hi[2] - lo[2] + 1;
+    int64_t count = 0;
+    for (int z = lo[0]; z <= hi[0]; z++) {
+        for (int y = lo[1]; y <= hi[1]; y++) {
+            const bool *row_a = a.data + (
+                (static_cast<size_t>(z - a.lo[0]) * a.height() + (y - a.lo[1])) * a.width() + (lo[2] - a.lo[2])
+            );
+            const bool *row_b = b.data + (
+                (static_cast<size_t>(z - b.lo[0]) * b.height() + (y - b.lo[1])) * b.width() + (lo[2] - b.lo[2])
+            );
+            count += count_and(row_a, row_b, run);
+        }
+    }
+    return count;
+}
+
+
+/**
+ * Finds every (a, b) pair with intersecting bboxes by sweeping both sets
+ * along z and testing y and x against the currently open boxes.
+ * Pairs are returned flattened and sorted.
+ */
+inline std::vector<int> find_bbox_overlaps(
+    const std::vector<MaskView> &a,
+    const std::vector<MaskView> &b
+) {
+    auto sorted_by_z = [](const std::vector<MaskView> &views) {
+        std::vector<int> order(views.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&views](int left, int right) {
+            return views[left].lo[0] < views[right].lo[0];
+        });
+        return order;
+    };
+    auto overlaps_yx = [](const MaskView &p, const MaskView &q) {
+        return p.lo[1] <= q.hi[1] && q.lo[1] <= p.hi[1] &&
+               p.lo[2] <= q.hi[2] && q.lo[2] <= p.hi[2];
+    };
+
+    std::vector<int> order_a = sorted_by_z(a);
+    std::vector<int> order_b = sorted_by_z(b);
+    std::vector<int> active_a, active_b;
+    std::vector<int> pairs;
+
+    size_t i = 0, j = 0;
+    while (i < order_a.size() || j < order_b.size()) {
+        bool take_a = j == order_b.size() ||
+            (i < order_a.size() && a[order_a[i]].lo[0] <= b[order_b[j]].lo[0]);
+        int z = take_a ? a[order_a[i]].lo[0] : b[order_b[j]].lo[0];
+
+        // boxes closed before this z can not meet any later box
+        active_a.erase(std::remove_if(active_a.begin(), active_a.end(),
+            [&](int k) { return a[k].hi[0] < z; }), active_a.end());
+        active_b.erase(std::remove_if(active_b.begin(), active_b.end(),
+            [&](int k) { return b[k].hi[0] < z; }), active_b.end());
+
+        if (take_a) {
+            int k = order_a[i++];
+            for (int other : active_b) {
+                if (overlaps_yx(a[k], b[other])) {
+                    pairs.push_back(k);
+                    pairs.push_back(other);
+                }
+            }
+            active_a.push_back(k);
+        } else {
+            int k = order_b[j++];
+            for (int other : active_a) {
+                if (overlaps_yx(a[other], b[k])) {
+                    pairs.push_back(other);
+                    pairs.push_back(k);
+                }
+            }
+            active_b.push_back(k);
+        }
+    }
+
+    std::vector<size_t> order(pairs.size() / 2);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&pairs](size_t left, size_t right) {
+        return std::make_pair(pairs[2 * left], pairs[2 * left + 1]) <
+               std::make_pair(pairs[2 * right], pairs[2 * right + 1]);
+    });
+    std::vector<int> sorted_pairs;
+    sorted_pairs.reserve(pairs.size());
+    for (size_t k : order) {
+        sorted_pairs.push_back(pairs[2 * k]);
+        sorted_pairs.push_back(pairs[2 * k + 1]);
+    }
+    return sorted_pairs;
+}
+
+
+/**
+ * Computes the intersection size and IoU between hypotheses of two result
+ * sets, e.g. consecutive frames. When `pairs` (shape (K, 2), indices into
+ * `segments_a` and `segments_b`) is not given, candidates are the pairs with
+ * intersecting bboxes and only pairs that actually overlap are returned.
+ * Returns the (pairs, intersection, iou) arrays.
+ */
+inline nb::tuple compute_overlaps(
+    const std::vector<Segment> &segments_a,
+    const std::vector<Segment> &segments_b,
+    std::optional<nb::ndarray<const int, nb::shape<-1, 2>, nb::c_contig>> pairs,
+    int num_threads
+) {
+    std::vector<MaskView> views_a, views_b;
+    views_a.reserve(segments_a.size());
+    views_b.reserve(segments_b.size());
+    for (const Segment &segment : segments_a) {
+        views_a.push_back(MaskView::from_segment(segment));
+    }
+    for (const Segment &segment : segments_b) {
+        views_b.push_back(MaskView::from_segment(segment));
+    }
+
+    std::vector<int> candidates;
+    if (pairs.has_value()) {
+        const int *data = pairs->data();
+        candidates.assign(data, data + pairs->shape(0) * 2);
+        for (size_t k = 0; k < candidates.size(); k += 2) {
+            if (candidates[k] < 0 || candidates[k] >= static_cast<int>(views_a.size()) ||
+                candidates[k + 1] < 0 || candidates[k + 1] >= static_cast<int>(views_b.size())) {
+                throw std::out_of_range("pair indices must be valid segment indices");
+            }
+        }
+    }
+
+    std::vector<int64_t> intersection;
+    std::vector<float> iou;
+    {
+        nb::gil_scoped_release release;
+
+        if (!pairs.has_value()) {
+            candidates = find_bbox_overlaps(views_a, views_b);
+        }
+
+        size_t num_pairs = candidates.size() / 2;
+        intersection.resize(num_pairs);
+        iou.resize(num_pairs);
+        parallel_for(num_pairs, [&](size_t k) {
+            const MaskView &a = views_a[candidates[2 * k]];
+            const MaskView &b = views_b[candidates[2 * k + 1]];
+            intersection[k] = mask_intersection(a, b);
+            int64_t total = a.num_pixels + b.num_pixels - intersection[k];
+            iou[k] = total > 0 ? static_cast<float>(intersection[k]) / total : 0.0f;
+        }, num_threads, 64);
+
+        if (!pairs.has_value()) {
+            size_t kept = 0;
+            for (size_t k = 0; k < num_pairs; k++) {
+                if (intersection[k] > 0) {
+                    candidates[2 * kept] = candidates[2 * k];
+                    candidates[2 * kept + 1] = candidates[2 * k + 1];
+                    intersection[kept] = intersection[k];
+                    iou[kept] = iou[k];
+                    kept++;
+                }
+            }
+            candidates.resize(2 * kept);
+            intersection.resize(kept);
+            iou.resize(kept);
+        }
+    }
+
+    size_t num_pairs = intersection.size();
+    return nb::make_tuple(
+        to_ndarray(std::move(candidates), {num_pairs, 2}),
+        to_ndarray(std::move(intersection), {num_pairs}),
+        to_ndarray(std::move(iou), {num_pairs})
+    );
+}
+
+#endif // OVERLAP_H
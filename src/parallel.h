@@ -0,0 +1,77 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Number of worker threads to use, where num_threads <= 0 selects
+ * every hardware thread.
+ */
+inline int resolve_num_threads(int num_threads) {
+    if (num_threads > 0) {
+        return num_threads;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+/**
+ * Calls f(i) for every i in [0, n) using a pool of threads that pull
+ * chunks of `grain` iterations from a shared counter, which balances
+ * uneven work. The first exception thrown by f is rethrown after all
+ * threads are joined. f must not touch Python objects.
+ */
+template <typename F>
+void parallel_for(size_t n, F &&f, int num_threads = 0, size_t grain = 1) {
+    if (n == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t num_chunks = (n + grain - 1) / grain;
+    size_t num_workers = std::min<size_t>(resolve_num_threads(num_threads), num_chunks);
+
+    std::atomic<size_t> next_chunk(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        try {
+            for (size_t c = next_chunk++; c < num_chunks; c = next_chunk++) {
+                size_t end = std::min(n, (c + 1) * grain);
+                for (size_t i = c * grain; i < end; i++) {
+                    f(i);
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next_chunk = num_chunks;
+        }
+    };
+
+    if (num_workers <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(num_workers - 1);
+        for (size_t t = 0; t + 1 < num_workers; t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,131 @@
+#ifndef SALIENCY_H
+#define SALIENCY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "edge_keys.h"
+#include "union_find.h"
+
+/**
+ * Writes the ultrametric contour map of one connected component: every
+ * voxel gets the largest level at which one of its faces is joined by the
+ * hierarchy, i.e. the level at which the regions on its sides merge.
+ *
+ * The merges of Kruskal over `edges`, ordered by `keys`, are recorded as a
+ * binary partition tree whose leaves are the voxels; the join level of a
+ * face is the level of the lowest common ancestor of its voxels, found for
+ * every face by Tarjan's offline algorithm during a post-order walk of the
+ * tree. Faces are enumerated from voxel coordinates, so no query list is
+ * stored.
+ *
+ * `leaf_of` is a volume shared by all components, -1 everywhere on entry
+ * and on return. Voxels without faces in the component keep their value.
+ * Time complexity: O(n α(n)) after sorting the edges
+ */
+template <typename EdgeWeight, typename Key>
+void accumulate_saliency(
+    const std::vector<int> &visited,
+    const std::vector<int> &edges,
+    const std::vector<Key> &keys,
+    const EdgeWeight &weight,
+    int depth,
+    int height,
+    int width,
+    std::vector<int> &leaf_of,
+    float *saliency
+) {
+    int n = static_cast<int>(visited.size());
+    if (n < 2) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        leaf_of[visited[i]] = i;
+    }
+
+    // binary partition tree: leaves 0..n-1, merges n..2n-2 in level order
+    std::vector<int> children(2 * (n - 1));
+    std::vector<float> levels(n - 1);
+    int num_nodes = n;
+    {
+        DenseSets components(n);
+        std::vector<int> node_of(n);  // tree node of each component root
+        for (int i = 0; i < n; i++) {
+            node_of[i] = i;
+        }
+        for (uint32_t e : argsort(keys)) {
+            int u = edges[2 * e];
+            int v = edges[2 * e + 1];
+            int root_u = components.find(leaf_of[u]);
+            int root_v = components.find(leaf_of[v]);
+            if (root_u == root_v) {
+                continue;
+            }
+            int merge = num_nodes++ - n;
+            children[2 * merge] = node_of[root_u];
+            children[2 * merge + 1] = node_of[root_v];
+            levels[merge] = weight(u, v);
+            node_of[components.unite_roots(root_u, root_v)] = merge + n;
+        }
+    }
+
+    // Tarjan's offline lowest common ancestors, walking the tree iteratively
+    DenseSets subtrees(num_nodes);
+    std::vector<int> ancestor(num_nodes);
+    std::vector<uint8_t> done(n, 0);
+    std::vector<std::pair<int, int>> stack = {{num_nodes - 1, 0}};  // (node, next child)
+    int plane = height * width;
+
+    while (!stack.empty()) {
+        auto &[node, next_child] = stack.back();
+        if (next_child == 0) {
+            ancestor[node] = node;
+        }
+
+        if (node >= n && next_child < 2) {
+            stack.emplace_back(children[2 * (node - n) + next_child++], 0);
+            continue;
+        }
+
+        int finished = node;
+        stack.pop_back();
+        if (finished < n) {
+            int idx = visited[finished];
+            int z = idx / plane;
+            int y = (idx % plane) / width;
+            int x = idx % width;
+            int neighbors[6];
+            int num_neighbors = 0;
+            if (z > 0) neighbors[num_neighbors++] = idx - plane;
+            if (z < depth - 1) neighbors[num_neighbors++] = idx + plane;
+            if (y > 0) neighbors[num_neighbors++] = idx - width;
+            if (y < height - 1) neighbors[num_neighbors++] = idx + width;
+            if (x > 0) neighbors[num_neighbors++] = idx - 1;
+            if (x < width - 1) neighbors[num_neighbors++] = idx + 1;
+
+            for (int i = 0; i < num_neighbors; i++) {
+                int other = leaf_of[neighbors[i]];
+                if (other < 0 || !done[other]) {
+                    continue;  // outside, or handled from the other side
+                }
+                float level = levels[ancestor[subtrees.find(other)] - n];
+                saliency[idx] = std::max(saliency[idx], level);
+                saliency[neighbors[i]] = std::max(saliency[neighbors[i]], level);
+            }
+            done[finished] = 1;
+        }
+
+        if (!stack.empty()) {
+            int up = stack.back().first;
+            int root = subtrees.unite_roots(subtrees.find(up), subtrees.find(finished));
+            ancestor[root] = up;
+        }
+    }
+
+    for (int idx : visited) {
+        leaf_of[idx] = -1;
+    }
+}
+
+#endif // SALIENCY_H
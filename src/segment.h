@@ -0,0 +1,145 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+
+namespace nb = nanobind;
+
+using namespace nb::literals;
+
+/**
+ * Physical size of a voxel along (z, y, x).
+ */
+using Spacing = std::array<float, 3>;
+
+struct Segment {
+    nb::ndarray<nb::numpy, bool> mask;
+    nb::ndarray<nb::numpy, int> bbox;
+    int num_pixels;
+    int z;
+    int y;
+    int x;
+    float volume;                   // num_pixels scaled by the voxel volume
+    std::array<float, 3> centroid;  // physical (z, y, x) center of mass
+    std::array<float, 6> moments;   // physical central moments (zz, zy, zx, yy, yx, xx)
+    float area;                     // physical area of the voxel faces on the boundary
+    float score;                    // mean edge weight across the in-volume boundary
+    int parent;                     // index of the smallest enclosing hypothesis, -1 if none
+
+    static Segment from_visited_and_bbox(
+        const std::vector<int>& visited,
+        int min_z, int min_y, int min_x,
+        int max_z, int max_y, int max_x,
+        int depth, int height, int width,
+        const Spacing &spacing
+    ) {
+        size_t mask_depth = max_z - min_z + 1;
+        size_t mask_height = max_y - min_y + 1;
+        size_t mask_width = max_x - min_x + 1;
+
+        bool *mask_data = new bool[mask_depth * mask_height * mask_width];
+        std::memset(mask_data, 0, mask_depth * mask_height * mask_width * sizeof(bool));
+
+        // first and second order sums are taken relative to the bbox corner
+        // to keep the float accumulation well conditioned
+        double sum[3] = {0.0, 0.0, 0.0};
+        double sum_sq[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        for (int idx : visited) {
+            int z = idx / (height * width) - min_z;
+            int y = (idx % (height * width)) / width - min_y;
+            int x = idx % width - min_x;
+            mask_data[z * mask_height * mask_width + y * mask_width + x] = true;
+
+            sum[0] += z;
+            sum[1] += y;
+            sum[2] += x;
+            sum_sq[0] += z * z;
+            sum_sq[1] += z * y;
+            sum_sq[2] += z * x;
+            sum_sq[3] += y * y;
+            sum_sq[4] += y * x;
+            sum_sq[5] += x * x;
+        }
+
+        double n = std::max<double>(visited.size(), 1.0);
+        double mean[3] = {sum[0] / n, sum[1] / n, sum[2] / n};
+        std::array<float, 3> centroid = {
+            static_cast<float>((min_z + mean[0]) * spacing[0]),
+            static_cast<float>((min_y + mean[1]) * spacing[1]),
+            static_cast<float>((min_x + mean[2]) * spacing[2]),
+        };
+
+        std::array<float, 6> moments;
+        int k = 0;
+        for (int i = 0; i < 3; i++) {
+            for (int j = i; j < 3; j++, k++) {
+                double cov = sum_sq[k] / n - mean[i] * mean[j];
+                moments[k] = static_cast<float>(cov * spacing[i] * spacing[j]);
+            }
+        }
+
+        size_t shape[3] = {mask_depth, mask_height, mask_width};
+        nb::capsule mask_owner(mask_data, [](void *p) noexcept {
+            delete[] (bool *) p;
+        });
+        auto mask = nb::ndarray<nb::numpy, bool>(mask_data, 3, shape, mask_owner);
+
+        int *bbox_data = new int[6]{min_z, min_y, min_x, max_z, max_y, max_x};
+        size_t bbox_shape[1] = {6};
+        nb::capsule bbox_owner(bbox_data, [](void *p) noexcept {
+            delete[] (int *) p;
+        });
+        auto bbox = nb::ndarray<nb::numpy, int>(bbox_data, 1, bbox_shape, bbox_owner);
+
+        return Segment{
+            .mask = mask,
+            .bbox = bbox,
+            .num_pixels = static_cast<int>(visited.size()),
+            .z = min_z,
+            .y = min_y,
+            .x = min_x,
+            .volume = visited.size() * spacing[0] * spacing[1] * spacing[2],
+            .centroid = centroid,
+            .moments = moments,
+            .area = 0.0f,
+            .score = 0.0f,
+            .parent = -1,
+        };
+    }
+
+    static Segment from_visited(
+        const std::vector<int> &visited,
+        int depth, int height, int width,
+        const Spacing &spacing
+    ) {
+        int min_z = depth - 1;
+        int min_y = height - 1;
+        int min_x = width - 1;
+        int max_z = 0;
+        int max_y = 0;
+        int max_x = 0;
+        for (int idx : visited) {
+            int z = idx / (height * width);
+            int y = (idx % (height * width)) / width;
+            int x = idx % width;
+            min_z = std::min(min_z, z);
+            min_y = std::min(min_y, y);
+            min_x = std::min(min_x, x);
+            max_z = std::max(max_z, z);
+            max_y = std::max(max_y, y);
+            max_x = std::max(max_x, x);
+        }
+        return Segment::from_visited_and_bbox(
+            visited, min_z, min_y, min_x,
+            max_z, max_y, max_x,
+            depth, height, width, spacing
+        );
+    }
+};
+
+#endif // SEGMENT_H
@@ -0,0 +1,144 @@
+#ifndef SMOOTHING_H
+#define SMOOTHING_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "parallel.h"
+
+/**
+ * Normalized Gaussian taps for offsets -radius..radius, truncated at four
+ * standard deviations and rounded to the nearest tap, with the radius and
+ * weights of scipy.ndimage.gaussian_filter.
+ */
+inline std::vector<float> gaussian_kernel(float sigma) {
+    double sd = sigma;
+    int radius = static_cast<int>(4.0 * sd + 0.5);
+    std::vector<double> taps(2 * radius + 1);
+    double sum = 0.0;
+    for (int i = -radius; i <= radius; i++) {
+        taps[i + radius] = std::exp(-0.5 / (sd * sd) * i * i);
+        sum += taps[i + radius];
+    }
+    std::vector<float> kernel(taps.size());
+    for (size_t i = 0; i < taps.size(); i++) {
+        kernel[i] = static_cast<float>(taps[i] / sum);
+    }
+    return kernel;
+}
+
+
+/**
+ * Index of position i on an axis of size n mirrored at its borders,
+ * (d c b a | a b c d | d c b a), scipy's "reflect" mode.
+ */
+inline int reflect_index(int i, int n) {
+    int period = 2 * n;
+    i %= period;
+    if (i < 0) {
+        i += period;
+    }
+    return i < n ? i : period - 1 - i;
+}
+
+
+/**
+ * Convolves along an axis of `length` samples stored `sample_step` floats
+ * apart, where every sample is a row of `run` contiguous floats. Each
+ * output row is a weighted sum of input rows, which vectorizes along the
+ * run. `scratch` receives a copy of the input rows.
+ */
+inline void convolve_rows(
+    float *data,
+    int length,
+    int64_t sample_step,
+    int run,
+    const std::vector<float> &kernel,
+    std::vector<float> &scratch
+) {
+    int radius = static_cast<int>(kernel.size() / 2);
+    scratch.resize(static_cast<size_t>(length) * run);
+    for (int i = 0; i < length; i++) {
+        std::copy(data + i * sample_step, data + i * sample_step + run, scratch.begin() + static_cast<size_t>(i) * run);
+    }
+    for (int i = 0; i < length; i++) {
+        float *out = data + i * sample_step;
+        std::fill(out, out + run, 0.0f);
+        for (int k = -radius; k <= radius; k++) {
+            const float *in = scratch.data() + static_cast<size_t>(reflect_index(i + k, length)) * run;
+            float tap = kernel[k + radius];
+            for (int x = 0; x < run; x++) {
+                out[x] += tap * in[x];
+            }
+        }
+    }
+}
+
+
+/**
+ * Separable Gaussian blur of a C-contiguous (depth, height, width) float
+ * volume, in place, with one standard deviation per axis in voxels.
+ * Axes with a non-positive sigma are left untouched.
+ *
+ * Each pass convolves whole contiguous rows: the z and y passes are
+ * weighted sums of rows, and the x pass convolves transposed tiles.
+ * Passes run in parallel over planes or tiles, so the only extra memory
+ * is a scratch copy of the rows of each task.
+ */
+inline void gaussian_smooth(
+    float *volume,
+    int depth,
+    int height,
+    int width,
+    const std::array<float, 3> &sigmas,
+    int num_threads
+) {
+    int64_t plane = static_cast<int64_t>(height) * width;
+
+    if (sigmas[2] > 0.0f) {
+        // x pass: transpose tiles of rows so samples along x become rows
+        std::vector<float> kernel = gaussian_kernel(sigmas[2]);
+        const int tile = 64;
+        int tiles_per_plane = (height + tile - 1) / tile;
+        parallel_for(static_cast<size_t>(depth) * tiles_per_plane, [&](size_t t) {
+            int z = static_cast<int>(t / tiles_per_plane);
+            int y0 = static_cast<int>(t % tiles_per_plane) * tile;
+            int rows = std::min(tile, height - y0);
+            float *base = volume + z * plane + static_cast<int64_t>(y0) * width;
+
+            std::vector<float> transposed(static_cast<size_t>(width) * rows);
+            std::vector<float> scratch;
+            for (int r = 0; r < rows; r++) {
+                for (int x = 0; x < width; x++) {
+                    transposed[static_cast<size_t>(x) * rows + r] = base[static_cast<int64_t>(r) * width + x];
+                }
+            }
+            convolve_rows(transposed.data(), width, rows, rows, kernel, scratch);
+            for (int r = 0; r < rows; r++) {
+                for (int x = 0; x < width; x++) {
+                    base[static_cast<int64_t>(r) * width + x] = transposed[static_cast<size_t>(x) * rows + r];
+                }
+            }
+        }, num_threads);
+    }
+
+    if (sigmas[1] > 0.0f) {
+        std::vector<float> kernel = gaussian_kernel(sigmas[1]);
+        parallel_for(depth, [&](size_t z) {
+            std::vector<float> scratch;
+            convolve_rows(volume + z * plane, height, width, width, kernel, scratch);
+        }, num_threads);
+    }
+
+    if (sigmas[0] > 0.0f) {
+        std::vector<float> kernel = gaussian_kernel(sigmas[0]);
+        parallel_for(height, [&](size_t y) {
+            std::vector<float> scratch;
+            convolve_rows(volume + y * width, depth, plane, width, kernel, scratch);
+        }, num_threads);
+    }
+}
+
+#endif // SMOOTHING_H
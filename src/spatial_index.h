@@ -0,0 +1,318 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+#include <nanobind/ndarray.h>
+#include <nanobind/nanobind.h>
+#include "array_utils.h"
+#include "parallel.h"
+#include "segment.h"
+
+namespace nb = nanobind;
+
+using Points = nb::ndarray<const float, nb::shape<-1, 3>, nb::c_contig>;
+
+/**
+ * Static kd-tree over 3D points, e.g. the physical centroids of the
+ * hypotheses of one frame, answering batched k-nearest and radius queries.
+ *
+ * Nodes split the widest axis at the median, so the tree is balanced and
+ * built in O(n log n). Points are stored in tree order next to their
+ * original ids, which keeps leaf scans contiguous.
+ */
+class SpatialIndex {
+private:
+    struct Node {
+        int start;   // range of tree-ordered points under the node
+        int end;
+        int left;    // child node ids, -1 for leaves
+        int right;
+        int axis;
+        float split;
+    };
+
+    static constexpr int leaf_size = 8;
+
+    std::vector<std::array<float, 3>> points;  // tree order
+    std::vector<int> ids;                      // tree order -> input index
+    std::vector<Node> nodes;
+
+public:
+    explicit SpatialIndex(std::vector<std::array<float, 3>> &&coordinates)
+        : points(std::move(coordinates)), ids(points.size()) {
+        std::iota(ids.begin(), ids.end(), 0);
+        if (!points.empty()) {
+            nodes.reserve(2 * points.size() / leaf_size + 1);
+            build(0, static_cast<int>(points.size()));
+        }
+    }
+
+    static SpatialIndex from_points(const Points &coordinates) {
+        return SpatialIndex(copy_points(coordinates));
+    }
+
+    /**
+     * Indexes the physical centroids of the segments.
+     */
+    static SpatialIndex from_segments(const std::vector<Segment> &segments) {
+        return SpatialIndex(centroids_of(segments));
+    }
+
+    int size() const {
+        return static_cast<int>(points.size());
+    }
+
+    /**
+     * For every query point, finds its k nearest indexed points within
+     * max_distance. Returns (pairs, distances) where each pair is
+     * (query index, indexed point index), grouped by query and sorted by
+     * increasing distance.
+     */
+    nb::tuple query_knn(const Points &queries, int k, float max_distance, int num_threads) const {
+        return knn_batch(copy_points(queries), k, max_distance, num_threads);
+    }
+
+    /**
+     * For every query point, finds all indexed points within radius.
+     * Output layout matches query_knn.
+     */
+    nb::tuple query_radius(const Points &queries, float radius, int num_threads) const {
+        return radius_batch(copy_points(queries), radius, num_threads);
+    }
+
+    nb::tuple query_knn_segments(const std::vector<Segment> &segments, int k, float max_distance, int num_threads) const {
+        return knn_batch(centroids_of(segments), k, max_distance, num_threads);
+    }
+
+    nb::tuple query_radius_segments(const std::vector<Segment> &segments, float radius, int num_threads) const {
+        return radius_batch(centroids_of(segments), radius, num_threads);
+    }
+
+private:
+    static std::vector<std::array<float, 3>> copy_points(const Points &coordinates) {
+        std::vector<std::array<float, 3>> result(coordinates.shape(0));
+        const float *data = coordinates.data();
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = {data[3 * i], data[3 * i + 1], data[3 * i + 2]};
+        }
+        return result;
+    }
+
+    static std::vector<std::array<float, 3>> centroids_of(const std::vector<Segment> &segments) {
+        std::vector<std::array<float, 3>> centroids;
+        centroids.reserve(segments.size());
+        for (const Segment &segment : segments) {
+            centroids.push_back(segment.centroid);
+        }
+        return centroids;
+    }
+
+    nb::tuple knn_batch(
+        const std::vector<std::array<float, 3>> &queries,
+        int k,
+        float max_distance,
+        int num_threads
+    ) const {
+        if (k < 1) {
+            throw std::invalid_argument("k must be positive");
+        }
+        float max_sq = max_distance * max_distance;
+        return batch(queries, num_threads,
+            [&](const std::array<float, 3> &q, std::vector<std::pair<float, int>> &found) {
+                knn(q, k, max_sq, found);
+            });
+    }
+
+    nb::tuple radius_batch(
+        const std::vector<std::array<float, 3>> &queries,
+        float radius,
+        int num_threads
+    ) const {
+        float radius_sq = radius * radius;
+        return batch(queries, num_threads,
+            [&](const std::array<float, 3> &q, std::vector<std::pair<float, int>> &found) {
+                if (!nodes.empty()) {
+                    within(0, q, radius_sq, found);
+                }
+                std::sort(found.begin(), found.end());
+            });
+    }
+
+    static float distance_sq(const std::array<float, 3> &a, const std::array<float, 3> &b) {
+        float dz = a[0] - b[0];
+        float dy = a[1] - b[1];
+        float dx = a[2] - b[2];
+        return dz * dz + dy * dy + dx * dx;
+    }
+
+    int build(int start, int end) {
+        int id = static_cast<int>(nodes.size());
+        nodes.push_back(Node{start, end, -1, -1, 0, 0.0f});
+        if (end - start <= leaf_size) {
+            return id;
+        }
+
+        std::array<float, 3> lo = points[start], hi = points[start];
+        for (int i = start + 1; i < end; i++) {
+            for (int a = 0; a < 3; a++) {
+                lo[a] = std::min(lo[a], points[i][a]);
+                hi[a] = std::max(hi[a], points[i][a]);
+            }
+        }
+        int axis = 0;
+        for (int a = 1; a < 3; a++) {
+            if (hi[a] - lo[a] > hi[axis] - lo[axis]) {
+                axis = a;
+            }
+        }
+
+        // partition an index permutation, then apply it to points and ids
+        int mid = start + (end - start) / 2;
+        std::vector<int> order(end - start);
+        std::iota(order.begin(), order.end(), start);
+        std::nth_element(order.begin(), order.begin() + (mid - start), order.end(),
+            [&](int left, int right) { return points[left][axis] < points[right][axis]; });
+        std::vector<std::array<float, 3>> sub_points(order.size());
+        std::vector<int> sub_ids(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            sub_points[i] = points[order[i]];
+            sub_ids[i] = ids[order[i]];
+        }
+        std::copy(sub_points.begin(), sub_points.end(), points.begin() + start);
+        std::copy(sub_ids.begin(), sub_ids.end(), ids.begin() + start);
+
+        nodes[id].axis = axis;
+        nodes[id].split = points[mid][axis];
+        int left = build(start, mid);
+        int right = build(mid, end);
+        nodes[id].left = left;
+        nodes[id].right = right;
+        return id;
+    }
+
+    void knn(
+        const std::array<float, 3> &q,
+        int k,
+        float max_sq,
+        std::vector<std::pair<float, int>> &found
+    ) const {
+        // max-heap on distance holding the best k so far
+        std::priority_queue<std::pair<float, int>> best;
+        if (!nodes.empty()) {
+            nearest(0, q, k, max_sq, best);
+        }
+        found.resize(best.size());
+        for (size_t i = found.size(); i-- > 0;) {
+            found[i] = best.top();
+            best.pop();
+        }
+    }
+
+    void nearest(
+        int id,
+        const std::array<float, 3> &q,
+        int k,
+        float max_sq,
+        std::priority_queue<std::pair<float, int>> &best
+    ) const {
+        const Node &node = nodes[id];
+        if (node.left < 0) {
+            for (int i = node.start; i < node.end; i++) {
+                float d = distance_sq(q, points[i]);
+                if (d > max_sq) {
+                    continue;
+                }
+                if (static_cast<int>(best.size()) < k) {
+                    best.emplace(d, ids[i]);
+                } else if (d < best.top().first) {
+                    best.pop();
+                    best.emplace(d, ids[i]);
+                }
+            }
+            return;
+        }
+
+        float diff = q[node.axis] - node.split;
+        int near_child = diff < 0 ? node.left : node.right;
+        int far_child = diff < 0 ? node.right : node.left;
+        nearest(near_child, q, k, max_sq, best);
+
+        float bound = static_cast<int>(best.size()) < k ? max_sq : std::min(max_sq, best.top().first);
+        if (diff * diff <= bound) {
+            nearest(far_child, q, k, max_sq, best);
+        }
+    }
+
+    void within(
+        int id,
+        const std::array<float, 3> &q,
+        float radius_sq,
+        std::vector<std::pair<float, int>> &found
+    ) const {
+        const Node &node = nodes[id];
+        if (node.left < 0) {
+            for (int i = node.start; i < node.end; i++) {
+                float d = distance_sq(q, points[i]);
+                if (d <= radius_sq) {
+                    found.emplace_back(d, ids[i]);
+                }
+            }
+            return;
+        }
+
+        float diff = q[node.axis] - node.split;
+        if (diff < 0 || diff * diff <= radius_sq) {
+            within(node.left, q, radius_sq, found);
+        }
+        if (diff >= 0 || diff * diff <= radius_sq) {
+            within(node.right, q, radius_sq, found);
+        }
+    }
+
+    /**
+     * Runs one search per query in parallel and concatenates the matches.
+     */
+    template <typename Search>
+    nb::tuple batch(
+        const std::vector<std::array<float, 3>> &queries,
+        int num_threads,
+        Search &&search
+    ) const {
+        std::vector<std::vector<std::pair<float, int>>> found(queries.size());
+        {
+            nb::gil_scoped_release release;
+            parallel_for(queries.size(), [&](size_t i) {
+                search(queries[i], found[i]);
+            }, num_threads, 256);
+        }
+
+        size_t total = 0;
+        for (const auto &matches : found) {
+            total += matches.size();
+        }
+        std::vector<int> pairs;
+        std::vector<float> distances;
+        pairs.reserve(2 * total);
+        distances.reserve(total);
+        for (size_t i = 0; i < found.size(); i++) {
+            for (const auto &[d, index] : found[i]) {
+                pairs.push_back(static_cast<int>(i));
+                pairs.push_back(index);
+                distances.push_back(std::sqrt(d));
+            }
+        }
+        return nb::make_tuple(
+            to_ndarray(std::move(pairs), {total, 2}),
+            to_ndarray(std::move(distances), {total})
+        );
+    }
+};
+
+#endif // SPATIAL_INDEX_H
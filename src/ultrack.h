@@ -1,168 +1,335 @@
 #include <vector>
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <functional>
+#include <limits>
 #include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <nanobind/ndarray.h>
 #include <nanobind/nanobind.h>
-#include "union_find.h"
+#include "basins.h"
+#include "blocks.h"
+#include "component_tree.h"
+#include "edge_keys.h"
+#include "edge_weights.h"
+#include "extinction.h"
+#include "flood.h"
+#include "hierarchy.h"
+#include "parallel.h"
+#include "saliency.h"
+#include "smoothing.h"
+#include "volume_view.h"
 
 namespace nb = nanobind;
 
 using namespace nb::literals;
 
-struct Segment {
-    nb::ndarray<nb::numpy, bool> mask;
-    nb::ndarray<nb::numpy, int> bbox;
-    int num_pixels;
-    int z;
-    int y;
-    int x;
-
-    static Segment from_visited_and_bbox(
-        const std::vector<int>& visited,
-        int min_z, int min_y, int min_x,
-        int max_z, int max_y, int max_x,
-        int depth, int height, int width
-    ) {
-        size_t mask_depth = max_z - min_z + 1;
-        size_t mask_height = max_y - min_y + 1;
-        size_t mask_width = max_x - min_x + 1;
-
-        bool *mask_data = new bool[mask_depth * mask_height * mask_width];
-        std::memset(mask_data, 0, mask_depth * mask_height * mask_width * sizeof(bool));
-        for (int idx : visited) {
-            int z = idx / (height * width) - min_z;
-            int y = (idx % (height * width)) / width - min_y;
-            int x = idx % width - min_x;
-            mask_data[z * mask_height * mask_width + y * mask_width + x] = true;
-        }
 
-        size_t shape[3] = {mask_depth, mask_height, mask_width};
-        nb::capsule mask_owner(mask_data, [](void *p) noexcept {
-            delete[] (bool *) p;
-        });
-        auto mask = nb::ndarray<nb::numpy, bool>(mask_data, 3, shape, mask_owner);
+/**
+ * Foreground predicate of integer masks: any nonzero value.
+ */
+template <typename Mask>
+struct NonZero {
+    Mask mask;
+
+    bool operator()(int idx) const {
+        return mask[idx] != 0;
+    }
+};
 
-        int *bbox_data = new int[6]{min_z, min_y, min_x, max_z, max_y, max_x};
-        size_t bbox_shape[1] = {6};
-        nb::capsule bbox_owner(bbox_data, [](void *p) noexcept {
-            delete[] (int *) p;
-        });
-        auto bbox = nb::ndarray<nb::numpy, int>(bbox_data, 1, bbox_shape, bbox_owner);
 
-        return Segment{
-            .mask = mask,
-            .bbox = bbox,
-            .num_pixels = static_cast<int>(visited.size()),
-            .z = min_z,
-            .y = min_y,
-            .x = min_x,
-        };
+/**
+ * Foreground predicate of label images: voxels of a single label.
+ */
+template <typename Mask>
+struct EqualsLabel {
+    Mask mask;
+    typename Mask::value_type label;
+
+    bool operator()(int idx) const {
+        return mask[idx] == label;
     }
+};
 
-    static Segment from_visited(
-        const std::vector<int> &visited,
-        int depth, int height, int width
-    ) {
-        int min_z = depth - 1;
-        int min_y = height - 1;
-        int min_x = width - 1;
-        int max_z = 0;
-        int max_y = 0;
-        int max_x = 0;
-        for (int idx : visited) {
-            int z = idx / (height * width);
-            int y = (idx % (height * width)) / width;
-            int x = idx % width;
-            min_z = std::min(min_z, z);
-            min_y = std::min(min_y, y);
-            min_x = std::min(min_x, x);
-            max_z = std::max(max_z, z);
-            max_y = std::max(max_y, y);
-            max_x = std::max(max_x, x);
-        }
-        return Segment::from_visited_and_bbox(
-            visited, min_z, min_y, min_x,
-            max_z, max_y, max_x,
-            depth, height, width
-        );
+
+/**
+ * Algorithms that build the hierarchy of a connected component.
+ */
+enum class Engine {
+    KRUSKAL,  // Kruskal over the search tree edges of the voxels
+    BASINS,   // Kruskal over the region adjacency graph of basins
+    FLOOD,    // Kruskal over every face, generated in order by a priority flood
+    TREE,     // min-tree of the contours by union-find by level
+};
+
+
+inline Engine parse_engine(const std::string &engine) {
+    if (engine == "kruskal") {
+        return Engine::KRUSKAL;
+    } else if (engine == "basins") {
+        return Engine::BASINS;
+    } else if (engine == "flood") {
+        return Engine::FLOOD;
+    } else if (engine == "tree") {
+        return Engine::TREE;
     }
+    throw std::invalid_argument("engine must be one of 'kruskal', 'basins', 'flood' or 'tree'");
+}
+
+
+inline Attribute parse_attribute(const std::string &attribute) {
+    if (attribute == "altitude") {
+        return Attribute::ALTITUDE;
+    } else if (attribute == "area") {
+        return Attribute::AREA;
+    } else if (attribute == "volume") {
+        return Attribute::VOLUME;
+    } else if (attribute == "dynamics") {
+        return Attribute::DYNAMICS;
+    }
+    throw std::invalid_argument("attribute must be one of 'altitude', 'area', 'volume' or 'dynamics'");
+}
+
+
+/**
+ * Options of the edge and hierarchy stages shared by every entry point.
+ */
+struct WatershedOptions {
+    bool compact_keys;   // order edges by 16-bit keys
+    int coarse_factor;   // block edge of the multi-resolution mode, 1 disables it
+    Engine engine;
+    Attribute attribute;  // merge order of the hierarchy
+    float min_extinction; // extinction value above which attribute merges emit
+    int num_threads;
 };
 
 
-std::vector<size_t> argsort(const std::vector<float> &array)
-{
-    std::vector<size_t> indices(array.size());
-    std::iota(indices.begin(), indices.end(), 0);
-    std::sort(indices.begin(), indices.end(),
-              [&array](int left, int right) -> bool {
-                  return array[left] < array[right];
-              });
+/**
+ * Receives the voxels of a foreground connected component and the edges
+ * of its search tree flattened as (u, v) pairs, split into the edges
+ * outside smooth blocks and the ones inside them.
+ */
+using ComponentCallback = std::function<void(
+    const std::vector<int> &, const std::vector<int> &, const std::vector<int> &
+)>;
+
+
+/**
+ * Feeds the edges to the hierarchy in increasing key order (Kruskal).
+ * Keys only order the merges, their levels are the exact edge weights.
+ */
+template <typename Key, typename EdgeWeight>
+void hierarchical_watershed(
+    HierarchyBuilder<EdgeWeight> &hierarchy,
+    const EdgeWeight &weight,
+    const std::vector<int> &edges,
+    const std::vector<Key> &keys
+) {
+    std::vector<uint32_t> sorted_indices = argsort(keys);
 
-    return indices;
+    for (size_t i = 0; i < sorted_indices.size(); i++)
+    {
+        size_t idx = sorted_indices[i];
+        int u = edges[idx * 2];
+        int v = edges[idx * 2 + 1];
+        hierarchy.merge(u, v, weight(u, v));
+    }
+}
+
+
+/**
+ * Feeds the spanning tree edges of an attribute hierarchy: the pruned
+ * merges are joined silently, then the basins they leave are emitted and
+ * the remaining merges emit as usual, gated by their altitude.
+ */
+template <typename EdgeWeight>
+void attribute_watershed(
+    HierarchyBuilder<EdgeWeight> &hierarchy,
+    const EdgeWeight &weight,
+    const AttributeMerges &merges
+) {
+    const std::vector<int> &edges = merges.edges;
+    for (size_t e = 0; e < merges.num_pruned; e++) {
+        hierarchy.join(edges[2 * e], edges[2 * e + 1]);
+    }
+    std::vector<int> basin(1);
+    for (size_t b = 0; b < merges.basins.size(); b++) {
+        basin[0] = merges.basins[b];
+        hierarchy.emit_components(basin, merges.basin_levels[b]);
+    }
+    for (size_t e = merges.num_pruned; e < merges.extinction.size(); e++) {
+        int u = edges[2 * e];
+        int v = edges[2 * e + 1];
+        hierarchy.merge(u, v, weight(u, v));
+    }
 }
 
 
-int hierarchical_watershed(
+/**
+ * Calls `f` with the sort keys of `edges`: 16-bit compact keys when
+ * `compact_keys` narrows them, the exact keys of the weight otherwise.
+ */
+template <typename EdgeWeight, typename F>
+void with_edge_keys(const EdgeWeight &weight, const std::vector<int> &edges, bool compact_keys, F &&f) {
+    using Key = typename EdgeWeight::key_type;
+
+    size_t num_edges = edges.size() / 2;
+    if (compact_keys && sizeof(Key) > sizeof(uint16_t)) {
+        std::vector<uint16_t> keys(num_edges);
+        for (size_t e = 0; e < num_edges; e++) {
+            keys[e] = compact_key(weight(edges[2 * e], edges[2 * e + 1]));
+        }
+        f(keys);
+    } else {
+        std::vector<Key> keys(num_edges);
+        for (size_t e = 0; e < num_edges; e++) {
+            keys[e] = weight.key(edges[2 * e], edges[2 * e + 1]);
+        }
+        f(keys);
+    }
+}
+
+
+/**
+ * Builds and emits the hierarchy of one connected component. The voxel
+ * ranges of `blocks` are joined and the `smooth_edges` merged in their
+ * own order before `edges` are merged, in altitude order or in the
+ * extinction order of an attribute, which needs the `index_of` scratch of
+ * attribute_merges.
+ */
+template <typename EdgeWeight>
+void build_hierarchy(
     std::vector<Segment> &segments,
     const std::vector<int> &visited,
     const std::vector<int> &edges,
-    const std::vector<float> &weights,
-    int min_num_pixels,
-    int max_num_pixels,
-    float min_frontier,
+    const std::vector<int> &smooth_edges,
+    const std::vector<int> &blocks,
+    const EdgeWeight &weight,
     int depth,
     int height,
-    int width
+    int width,
+    const HierarchyParams &params,
+    const WatershedOptions &options,
+    std::vector<int> &index_of
 ) {
-    std::vector<size_t> sorted_indices = argsort(weights);
+    HierarchyBuilder<EdgeWeight> hierarchy(
+        segments, visited, params, weight, depth, height, width
+    );
 
-    int num_segments = 0;
-    UnionFind uf(visited);
+    // basins and smooth blocks are joined by edges of at most min_frontier,
+    // which come first and emit nothing, so their order does not matter
+    for (size_t b = 0; b < blocks.size(); b += 2) {
+        hierarchy.merge_block(blocks[b], blocks[b + 1]);
+    }
+    for (size_t e = 0; e < smooth_edges.size(); e += 2) {
+        hierarchy.merge(smooth_edges[e], smooth_edges[e + 1], weight(smooth_edges[e], smooth_edges[e + 1]));
+    }
 
-    for (size_t i = 0; i < sorted_indices.size(); i++)
-    {
-        int idx = sorted_indices[i];
-        int u = edges[idx * 2];
-        int v = edges[idx * 2 + 1];
-        bool is_new = uf.unite(u, v);
-        if (is_new && weights[idx] > min_frontier)
-        {
-            int size = uf.get_size(u);
-            if (size > min_num_pixels && size < max_num_pixels)
-            {
-                segments.push_back(
-                    Segment::from_visited(
-                        uf.get_component(u), depth, height, width
-                    )
-                );
-                num_segments++;
-            }
+    with_edge_keys(weight, edges, options.compact_keys, [&](const auto &keys) {
+        if (options.attribute == Attribute::ALTITUDE) {
+            hierarchical_watershed(hierarchy, weight, edges, keys);
+            return;
         }
+        const Spacing &s = params.spacing;
+        AttributeMerges merges = attribute_merges(
+            visited, edges, keys, blocks, weight, options.attribute, s[0] * s[1] * s[2],
+            options.min_extinction, depth, height, width, index_of
+        );
+        attribute_watershed(hierarchy, weight, merges);
+    });
+    hierarchy.finalize();
+}
+
+
+/**
+ * Builds and emits the min-tree hierarchy of one connected component,
+ * sorting its voxels instead of its edges. Components of at least
+ * 2^15 voxels per thread build their tree in parallel slabs, with the
+ * GIL released.
+ */
+template <typename EdgeWeight>
+void build_component_tree(
+    std::vector<Segment> &segments,
+    const std::vector<int> &visited,
+    const EdgeWeight &weight,
+    int depth,
+    int height,
+    int width,
+    const HierarchyParams &params,
+    const WatershedOptions &options,
+    TreeScratch &scratch
+) {
+    {
+        nb::gil_scoped_release release;
+        const size_t min_slab_voxels = size_t(1) << 15;
+        size_t num_slabs = std::clamp<size_t>(
+            visited.size() / min_slab_voxels, 1, resolve_num_threads(options.num_threads)
+        );
+        MinTreeBuilder<EdgeWeight> tree(visited, weight, depth, height, width, scratch);
+        tree.build(static_cast<int>(num_slabs), options.num_threads);
     }
-    return num_segments;
+
+    HierarchyBuilder<EdgeWeight> hierarchy(
+        segments, visited, params, weight, depth, height, width
+    );
+    replay_min_tree(hierarchy, visited, weight, scratch);
+    hierarchy.finalize();
 }
 
 
-template <typename T>
-void compute_connected_components(
+/**
+ * Builds and emits the altitude hierarchy of one connected component,
+ * merging its faces as the priority flood generates them, in ascending
+ * key order, so no edge list is stored or sorted.
+ */
+template <typename EdgeWeight>
+void build_flood_hierarchy(
     std::vector<Segment> &segments,
-    const bool *fg_data,
-    const T *ctr_data,
+    const std::vector<int> &visited,
+    const EdgeWeight &weight,
+    int depth,
+    int height,
+    int width,
+    const HierarchyParams &params,
+    const WatershedOptions &options,
+    FloodScratch &scratch
+) {
+    HierarchyBuilder<EdgeWeight> hierarchy(
+        segments, visited, params, weight, depth, height, width
+    );
+    flood_merges(visited, weight, options.compact_keys, depth, height, width, scratch, [&](int u, int v) {
+        hierarchy.merge(u, v, weight(u, v));
+    });
+    hierarchy.finalize();
+}
+
+
+/**
+ * Collects the voxels and search tree edges of the connected component of
+ * cur_idx. With a block grid, the tree edges inside smooth blocks go to
+ * `smooth_edges` instead of `edges`.
+ */
+template <typename Foreground>
+void compute_connected_components(
+    const Foreground &is_fg,
     bool *seen_data,
     int depth,
     int height,
     int width,
-    int min_num_pixels,
-    int max_num_pixels,
-    float min_frontier,
-    int cur_idx
+    int cur_idx,
+    const BlockGrid *grid,
+    std::vector<int> &visited,
+    std::vector<int> &edges,
+    std::vector<int> &smooth_edges
 ) {
     std::vector<int> queue = {cur_idx};
-    std::vector<int> visited;
-
-    std::vector<int> edges;
-    std::vector<float> weights;
+    visited.clear();
+    edges.clear();
+    smooth_edges.clear();
 
     int offsets[18] = {
         0, 0, 1,
@@ -173,13 +340,6 @@ void compute_connected_components(
         -1, 0, 0,
     };
 
-    int min_z = depth - 1;
-    int min_y = height - 1;
-    int min_x = width - 1;
-    int max_z = 0;
-    int max_y = 0;
-    int max_x = 0;
-
     while (!queue.empty())
     {
         int idx = queue.back();
@@ -191,12 +351,6 @@ void compute_connected_components(
         int cur_y = (idx % (height * width)) / width;
         int cur_x = idx % width;
 
-        min_z = std::min(min_z, cur_z);
-        min_y = std::min(min_y, cur_y);
-        min_x = std::min(min_x, cur_x);
-        max_z = std::max(max_z, cur_z);
-        max_y = std::max(max_y, cur_y);
-        max_x = std::max(max_x, cur_x);
         for (int i = 0; i < 6; i++) {
             int nz = cur_z + offsets[i * 3];
             int ny = cur_y + offsets[i * 3 + 1];
@@ -207,56 +361,39 @@ void compute_connected_components(
                 nx >= 0 && nx < width
             ) {
                 int nidx = nz * height * width + ny * width + nx;
-                if (fg_data[nidx] && !seen_data[nidx]) {
+                if (!seen_data[nidx] && is_fg(nidx)) {
                     seen_data[nidx] = true;
                     queue.push_back(nidx);
 
-                    edges.push_back(idx);
-                    edges.push_back(nidx);
-
-                    float w = 0.5f * (ctr_data[idx] + ctr_data[nidx]);
-                    weights.push_back(w);
+                    std::vector<int> &tree = grid && grid->is_smooth_edge(idx, nidx) ? smooth_edges : edges;
+                    tree.push_back(idx);
+                    tree.push_back(nidx);
                 }
             }
         }
     }
-
-    int num_segments = hierarchical_watershed(
-        segments, visited, edges, weights,
-        min_num_pixels, max_num_pixels, min_frontier,
-        depth, height, width
-    );
-
-    if (num_segments == 0) {
-        segments.push_back(
-            Segment::from_visited_and_bbox(
-                visited, min_z, min_y, min_x,
-                max_z, max_y, max_x, depth, height, width
-            )
-        );
-    }
 }
 
 
-template <typename T>
-std::vector<Segment> compute_segmentation_hypotheses(
-    const nb::ndarray<bool>& foreground,
-    const nb::ndarray<T>& contours,
-    int min_num_pixels,
-    int max_num_pixels,
-    float min_frontier
+/**
+ * Runs the connected components of every foreground voxel in scan order.
+ */
+template <typename Foreground>
+void compute_all_components(
+    const Foreground &is_fg,
+    int depth,
+    int height,
+    int width,
+    const BlockGrid *grid,
+    const ComponentCallback &process
 ) {
-    size_t depth = foreground.shape(0);
-    size_t height = foreground.shape(1);
-    size_t width = foreground.shape(2);
-
-    bool *seen_data = new bool[depth * height * width];
-    std::memset(seen_data, 0, depth * height * width * sizeof(bool));
-
-    bool *fg_data = foreground.data();
-    T *ctr_data = contours.data();
+    size_t size = static_cast<size_t>(depth) * height * width;
+    bool *seen_data = new bool[size];
+    std::memset(seen_data, 0, size * sizeof(bool));
 
-    std::vector<Segment> segments;
+    std::vector<int> visited;
+    std::vector<int> edges;
+    std::vector<int> smooth_edges;
 
     for (int z = 0; z < depth; z++) {
         int z_step = z * height * width;
@@ -264,17 +401,532 @@ std::vector<Segment> compute_segmentation_hypotheses(
             int y_step = y * width;
             for (int x = 0; x < width; x++) {
                 int idx = z_step + y_step + x;
-                if (fg_data[idx] && !seen_data[idx]) {
+                if (!seen_data[idx] && is_fg(idx)) {
                     compute_connected_components(
-                        segments, fg_data, ctr_data, seen_data,
-                        depth, height, width,
-                        min_num_pixels, max_num_pixels, min_frontier, idx
+                        is_fg, seen_data, depth, height, width, idx, grid, visited, edges, smooth_edges
                     );
+                    process(visited, edges, smooth_edges);
                 }
             }
         }
     }
 
     delete[] seen_data;
+}
+
+
+/**
+ * Selects the foreground predicate of a mask whose values are F.
+ * Throws std::invalid_argument for a label outside the range of the mask dtype.
+ */
+template <bool Contiguous, typename F>
+void visit_foreground_as(
+    const nb::ndarray<nb::ro> &foreground,
+    bool is_signed,
+    std::optional<int64_t> label,
+    const BlockGrid *grid,
+    const ComponentCallback &process
+) {
+    int depth = foreground.shape(0);
+    int height = foreground.shape(1);
+    int width = foreground.shape(2);
+    int64_t strides[3] = {foreground.stride(0), foreground.stride(1), foreground.stride(2)};
+
+    using Mask = VolumeView<F, Contiguous>;
+    Mask mask(static_cast<const F *>(foreground.data()), strides, height, width);
+
+    if (!label.has_value()) {
+        compute_all_components(NonZero<Mask>{mask}, depth, height, width, grid, process);
+        return;
+    }
+
+    // masks are read through unsigned types of the same width,
+    // so signed labels are compared by their two's complement bits
+    using Signed = std::make_signed_t<F>;
+    bool in_range = is_signed
+        ? *label >= std::numeric_limits<Signed>::min() && *label <= std::numeric_limits<Signed>::max()
+        : *label >= 0 && static_cast<uint64_t>(*label) <= std::numeric_limits<F>::max();
+    if (!in_range) {
+        throw std::invalid_argument("label is outside the range of the foreground dtype");
+    }
+    EqualsLabel<Mask> is_fg{mask, static_cast<F>(*label)};
+    compute_all_components(is_fg, depth, height, width, grid, process);
+}
+
+
+/**
+ * Calls `process` on every connected component of a boolean or integer
+ * foreground, dispatching on the width and layout of its dtype.
+ * The callback runs once per component, so it is not templated.
+ */
+inline void visit_foreground(
+    const nb::ndarray<nb::ro> &foreground,
+    std::optional<int64_t> label,
+    const BlockGrid *grid,
+    const ComponentCallback &process
+) {
+    // only the width matters to the predicates, signedness only to labels
+    auto dtype = foreground.dtype();
+    bool is_signed = dtype.code == static_cast<uint8_t>(nb::dlpack::dtype_code::Int);
+    if (dtype.lanes != 1 || !(is_signed ||
+        dtype.code == static_cast<uint8_t>(nb::dlpack::dtype_code::UInt) ||
+        dtype.code == static_cast<uint8_t>(nb::dlpack::dtype_code::Bool))) {
+        throw std::invalid_argument("foreground must be a boolean or integer array");
+    }
+
+    bool contiguous = is_c_contiguous(foreground);
+    switch (dtype.bits) {
+    case 8:
+        return contiguous ? visit_foreground_as<true, uint8_t>(foreground, is_signed, label, grid, process)
+                          : visit_foreground_as<false, uint8_t>(foreground, is_signed, label, grid, process);
+    case 16:
+        return contiguous ? visit_foreground_as<true, uint16_t>(foreground, is_signed, label, grid, process)
+                          : visit_foreground_as<false, uint16_t>(foreground, is_signed, label, grid, process);
+    case 32:
+        return contiguous ? visit_foreground_as<true, uint32_t>(foreground, is_signed, label, grid, process)
+                          : visit_foreground_as<false, uint32_t>(foreground, is_signed, label, grid, process);
+    case 64:
+        return contiguous ? visit_foreground_as<true, uint64_t>(foreground, is_signed, label, grid, process)
+                          : visit_foreground_as<false, uint64_t>(foreground, is_signed, label, grid, process);
+    default:
+        throw std::invalid_argument("unsupported foreground dtype width");
+    }
+}
+
+
+/**
+ * Builds the hierarchies of every foreground component with one edge weight policy.
+ */
+template <typename EdgeWeight>
+std::vector<Segment> compute_with_weight(
+    const nb::ndarray<nb::ro> &foreground,
+    std::optional<int64_t> label,
+    const EdgeWeight &weight,
+    const HierarchyParams &params,
+    const WatershedOptions &options
+) {
+    int depth = foreground.shape(0);
+    int height = foreground.shape(1);
+    int width = foreground.shape(2);
+
+    constexpr bool keys_voxels = KeysVoxels<EdgeWeight>::value;
+    if (options.engine == Engine::TREE && !keys_voxels) {
+        throw std::invalid_argument("engine 'tree' requires voxel contours with edge_weight 'max'");
+    }
+    if (options.engine == Engine::TREE && options.attribute != Attribute::ALTITUDE) {
+        throw std::invalid_argument("attribute hierarchies require engine 'kruskal', 'basins' or 'flood'");
+    }
+
+    // only the sorted edges of Kruskal by altitude have work to skip
+    std::optional<BlockGrid> grid;
+    if (options.coarse_factor > 1 && options.engine == Engine::KRUSKAL && options.attribute == Attribute::ALTITUDE) {
+        grid.emplace(options.coarse_factor, depth, height, width);
+        nb::gil_scoped_release release;
+        mark_smooth_blocks(*grid, weight, params.min_frontier, options.num_threads);
+    }
+
+    std::vector<int> basin_of;
+    if (options.engine == Engine::BASINS) {
+        basin_of.assign(static_cast<size_t>(depth) * height * width, OUTSIDE);
+    }
+    std::optional<FloodScratch> flood_scratch;
+    if (options.engine == Engine::FLOOD) {
+        flood_scratch.emplace(static_cast<size_t>(depth) * height * width);
+    }
+    std::vector<int> index_of;
+    if (options.attribute != Attribute::ALTITUDE) {
+        index_of.assign(static_cast<size_t>(depth) * height * width, -1);
+    }
+    std::optional<TreeScratch> tree_scratch;
+    if (options.engine == Engine::TREE) {
+        tree_scratch.emplace(static_cast<size_t>(depth) * height * width);
+    }
+
+    std::vector<Segment> segments;
+    visit_foreground(foreground, label, grid ? &*grid : nullptr, [&](
+        const std::vector<int> &visited, const std::vector<int> &edges, const std::vector<int> &smooth_edges
+    ) {
+        if (options.engine == Engine::BASINS) {
+            Basins basins = find_basins(visited, weight, params.min_frontier, depth, height, width, basin_of);
+            build_hierarchy(
+                segments, basins.voxels, basins.edges, {}, basins.ranges,
+                weight, depth, height, width, params, options, index_of
+            );
+            return;
+        }
+        if constexpr (keys_voxels) {
+            if (options.engine == Engine::TREE) {
+                build_component_tree(
+                    segments, visited, weight, depth, height, width, params, options, *tree_scratch
+                );
+                return;
+            }
+        }
+        if (options.engine == Engine::FLOOD && options.attribute == Attribute::ALTITUDE) {
+            build_flood_hierarchy(
+                segments, visited, weight, depth, height, width, params, options, *flood_scratch
+            );
+            return;
+        }
+        if (options.engine == Engine::FLOOD) {
+            std::vector<int> tree = flood_spanning_tree(
+                visited, weight, options.compact_keys, depth, height, width, *flood_scratch
+            );
+            build_hierarchy(
+                segments, visited, tree, {}, {}, weight, depth, height, width, params, options, index_of
+            );
+            return;
+        }
+        build_hierarchy(
+            segments, visited, edges, smooth_edges, {}, weight, depth, height, width, params, options, index_of
+        );
+    });
     return segments;
 }
+
+
+/**
+ * Calls `f` with the edge weight policy named `edge_weight` over a contour view.
+ */
+template <typename Contours, typename F>
+auto with_edge_weight(const Contours &contours, const std::string &edge_weight, F &&f) {
+    if (edge_weight == "mean") {
+        return f(MeanWeight<Contours>{contours});
+    } else if (edge_weight == "max") {
+        return f(MaxWeight<Contours>{contours});
+    } else if (edge_weight == "min") {
+        return f(MinWeight<Contours>{contours});
+    } else if (edge_weight == "absdiff") {
+        return f(AbsDiffWeight<Contours>{contours});
+    }
+    throw std::invalid_argument("edge_weight must be one of 'mean', 'max', 'min' or 'absdiff'");
+}
+
+
+/**
+ * Dispatches on the edge weight policy of a contour view.
+ */
+template <typename Contours>
+std::vector<Segment> compute_with_contours(
+    const nb::ndarray<nb::ro> &foreground,
+    std::optional<int64_t> label,
+    const Contours &contours,
+    const std::string &edge_weight,
+    const HierarchyParams &params,
+    const WatershedOptions &options
+) {
+    return with_edge_weight(contours, edge_weight, [&](const auto &weight) {
+        return compute_with_weight(foreground, label, weight, params, options);
+    });
+}
+
+
+/**
+ * Copies a volume of any dtype and layout into a C-contiguous float buffer,
+ * in parallel over z-planes.
+ */
+template <typename T>
+std::vector<float> to_float_volume(const nb::ndarray<const T> &array, int num_threads) {
+    int depth = array.shape(0);
+    int height = array.shape(1);
+    int width = array.shape(2);
+    int64_t sz = array.stride(0), sy = array.stride(1), sx = array.stride(2);
+    const T *data = array.data();
+
+    std::vector<float> volume(static_cast<size_t>(depth) * height * width);
+    parallel_for(depth, [&](size_t z) {
+        float *out = volume.data() + z * height * width;
+        for (int y = 0; y < height; y++) {
+            const T *row = data + z * sz + y * sy;
+            for (int x = 0; x < width; x++) {
+                out[y * width + x] = static_cast<float>(row[x * sx]);
+            }
+        }
+    }, num_threads);
+    return volume;
+}
+
+
+/**
+ * Computes the segmentation hypotheses of every foreground connected component.
+ * `foreground` is a boolean or integer array where nonzero voxels are
+ * foreground; when `label` is given only voxels equal to it are, which
+ * refines a single instance of a label image without relabeling it. A
+ * label that the foreground dtype can not hold raises ValueError.
+ * Both arrays may be read-only, sliced or in any memory order; they are
+ * read in place, with a faster path for C-contiguous ones.
+ * `edge_weight` combines the contour values of two adjacent voxels into
+ * the weight of their edge: their "mean", "max", "min" or "absdiff".
+ * `min_num_pixels` and `max_num_pixels` bound the physical volume of a
+ * hypothesis, i.e. its number of voxels times the product of `spacing`;
+ * with the default unit spacing they are plain voxel counts.
+ * Integer contours are handled in their own units, so `min_frontier` is
+ * compared to edge weights in raw values, e.g. in [0, 255] for uint8.
+ * Hypotheses whose sphericity, measured on their voxel faces, is below
+ * `min_sphericity` are discarded before their masks are built.
+ * With `compact_keys`, edges are ordered by 16-bit keys that keep about
+ * three significant digits of their weights, which trims the edge stage of
+ * giant components; levels compared to `min_frontier` stay exact.
+ * A positive `sigma` first blurs the contours with a Gaussian of that
+ * standard deviation in physical units, i.e. sigma / spacing voxels per
+ * axis. The blur runs on an internal float buffer with `num_threads`
+ * threads, and the input is never modified.
+ * A `coarse_factor` above 1 enables the multi-resolution mode of the
+ * "kruskal" engine by altitude: a coarse pass over blocks of that edge
+ * finds the smooth blocks, whose internal edges all weigh at most
+ * `min_frontier`, and the search tree edges inside them are merged
+ * unsorted before the others are sorted. No hypothesis is emitted at
+ * those levels, so with exact keys the hypotheses are the same as with a
+ * `coarse_factor` of 1. The other engines ignore it; "basins" already
+ * floods every region below `min_frontier` without sorting.
+ * `engine` selects how each component hierarchy is built. "kruskal" sorts
+ * the edges of a spanning tree of the component voxels. "basins" first
+ * floods the basins joined by edges of at most `min_frontier`, where no
+ * hypothesis can be emitted, then runs Kruskal over the region adjacency
+ * graph, one edge per pair of adjacent basins at their lowest face. It
+ * considers every face of the component and sorts far fewer edges when
+ * most of them are below `min_frontier`. "flood" merges every face in
+ * ascending order as a priority flood from the contour minima reaches it,
+ * with a bucket queue for 16-bit keys and a radix heap otherwise, so only
+ * the seeds and the flood frontier are queued and no edge list is sorted;
+ * attribute hierarchies still collect its spanning tree. Both give the
+ * hypotheses of all faces.
+ * "tree" builds the min-tree of the contours, the hierarchy of the "max"
+ * edge weight, which it requires, by sorting the voxels instead of the
+ * edges (union-find by level), with no edge list at all. Large components
+ * build their tree in z-slabs on `num_threads` threads, merged along the
+ * slab boundaries; voxels are keyed exactly, so `compact_keys` does not
+ * apply.
+ * `attribute` sets the merge order of the hierarchy. "altitude" merges by
+ * edge weight. "area", "volume" and "dynamics" reorder the merges of the
+ * engine's spanning tree by the extinction value of that attribute of the
+ * minima they join: the physical volume, the lake volume up to the saddle
+ * (volume times levels) or the lake depth of the weaker side, in near
+ * linear time with union-find. Merges that join no two minima, or whose
+ * extinction value is at most `min_extinction`, emit nothing, and each
+ * basin they leave is emitted once, so far fewer hypotheses are produced
+ * for the same regions; `min_frontier` still gates every emission by
+ * altitude. The "tree" engine only builds altitude hierarchies.
+ */
+template <typename T>
+std::vector<Segment> compute_segmentation_hypotheses(
+    const nb::ndarray<nb::ro>& foreground,
+    const nb::ndarray<const T>& contours,
+    float min_num_pixels,
+    float max_num_pixels,
+    float min_frontier,
+    const Spacing &spacing,
+    float min_sphericity,
+    std::optional<int64_t> label,
+    bool compact_keys,
+    const std::string &edge_weight,
+    float sigma,
+    int coarse_factor,
+    const std::string &engine,
+    const std::string &attribute,
+    float min_extinction,
+    int num_threads
+) {
+    HierarchyParams params = {
+        min_num_pixels, max_num_pixels, min_frontier, spacing, min_sphericity
+    };
+    WatershedOptions options = {
+        compact_keys, coarse_factor, parse_engine(engine), parse_attribute(attribute), min_extinction, num_threads
+    };
+
+    if (foreground.ndim() != 3 || contours.ndim() != 3) {
+        throw std::invalid_argument("foreground and contours must be 3D arrays");
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (foreground.shape(i) != contours.shape(i)) {
+            throw std::invalid_argument("foreground and contours must have the same shape");
+        }
+    }
+
+    int depth = contours.shape(0);
+    int height = contours.shape(1);
+    int width = contours.shape(2);
+
+    if (sigma > 0.0f) {
+        std::vector<float> smoothed;
+        {
+            nb::gil_scoped_release release;
+            smoothed = to_float_volume(contours, num_threads);
+            std::array<float, 3> sigmas = {sigma / spacing[0], sigma / spacing[1], sigma / spacing[2]};
+            gaussian_smooth(smoothed.data(), depth, height, width, sigmas, num_threads);
+        }
+        int64_t strides[3] = {static_cast<int64_t>(height) * width, width, 1};
+        VolumeView<float, true> view(smoothed.data(), strides, height, width);
+        return compute_with_contours(foreground, label, view, edge_weight, params, options);
+    }
+
+    int64_t strides[3] = {contours.stride(0), contours.stride(1), contours.stride(2)};
+
+    // views such as vol[t, :, ::2] are read in place through their strides
+    if (is_c_contiguous(contours)) {
+        VolumeView<T, true> view(contours.data(), strides, height, width);
+        return compute_with_contours(foreground, label, view, edge_weight, params, options);
+    }
+    VolumeView<T, false> view(contours.data(), strides, height, width);
+    return compute_with_contours(foreground, label, view, edge_weight, params, options);
+}
+
+
+/**
+ * Computes the segmentation hypotheses from per-axis affinities shaped
+ * (3, Z, Y, X) instead of voxel contours. Channel a at voxel v is the
+ * affinity between v and its predecessor along axis a (z, y, x), and edges
+ * weigh its complement: one minus it for floating affinities, the dtype
+ * maximum minus it for integer ones. `min_frontier` is compared to these
+ * weights. Other arguments match compute_segmentation_hypotheses.
+ */
+template <typename T>
+std::vector<Segment> compute_affinity_hypotheses(
+    const nb::ndarray<nb::ro>& foreground,
+    const nb::ndarray<const T>& affinities,
+    float min_num_pixels,
+    float max_num_pixels,
+    float min_frontier,
+    const Spacing &spacing,
+    float min_sphericity,
+    std::optional<int64_t> label,
+    bool compact_keys,
+    int coarse_factor,
+    const std::string &engine,
+    const std::string &attribute,
+    float min_extinction,
+    int num_threads
+) {
+    HierarchyParams params = {
+        min_num_pixels, max_num_pixels, min_frontier, spacing, min_sphericity
+    };
+    WatershedOptions options = {
+        compact_keys, coarse_factor, parse_engine(engine), parse_attribute(attribute), min_extinction, num_threads
+    };
+
+    if (foreground.ndim() != 3 || affinities.ndim() != 4 || affinities.shape(0) != 3) {
+        throw std::invalid_argument("foreground must be a 3D array and affinities must be shaped (3, Z, Y, X)");
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (foreground.shape(i) != affinities.shape(i + 1)) {
+            throw std::invalid_argument("foreground and affinities must have the same spatial shape");
+        }
+    }
+
+    int height = affinities.shape(2);
+    int width = affinities.shape(3);
+    int64_t strides[3] = {affinities.stride(1), affinities.stride(2), affinities.stride(3)};
+    bool contiguous = (affinities.shape(1) == 1 || strides[0] == height * width) &&
+                      (height == 1 || strides[1] == width) &&
+                      (width == 1 || strides[2] == 1);
+
+    auto compute = [&](auto contiguous_tag) {
+        using Channel = VolumeView<T, decltype(contiguous_tag)::value>;
+        AffinityWeight<Channel> weight{{
+            Channel(affinities.data(), strides, height, width),
+            Channel(affinities.data() + affinities.stride(0), strides, height, width),
+            Channel(affinities.data() + 2 * affinities.stride(0), strides, height, width),
+        }, height, width};
+        return compute_with_weight(foreground, label, weight, params, options);
+    };
+    if (contiguous) {
+        return compute(std::true_type{});
+    }
+    return compute(std::false_type{});
+}
+
+
+/**
+ * Paints the saliency of every foreground component with one edge weight
+ * policy into a float volume, zero outside the foreground.
+ */
+template <typename EdgeWeight>
+std::vector<float> saliency_with_weight(
+    const nb::ndarray<nb::ro> &foreground,
+    std::optional<int64_t> label,
+    const EdgeWeight &weight,
+    bool compact_keys,
+    Engine engine
+) {
+    int depth = foreground.shape(0);
+    int height = foreground.shape(1);
+    int width = foreground.shape(2);
+    size_t size = static_cast<size_t>(depth) * height * width;
+
+    std::vector<float> saliency(size, 0.0f);
+    std::vector<int> leaf_of(size, -1);
+    std::optional<FloodScratch> flood_scratch;
+    if (engine == Engine::FLOOD) {
+        flood_scratch.emplace(size);
+    }
+
+    visit_foreground(foreground, label, nullptr, [&](
+        const std::vector<int> &visited, const std::vector<int> &edges, const std::vector<int> &
+    ) {
+        std::vector<int> tree;
+        if (engine == Engine::FLOOD) {
+            tree = flood_spanning_tree(visited, weight, compact_keys, depth, height, width, *flood_scratch);
+        }
+        const std::vector<int> &merged = engine == Engine::FLOOD ? tree : edges;
+        with_edge_keys(weight, merged, compact_keys, [&](const auto &keys) {
+            accumulate_saliency(
+                visited, merged, keys, weight, depth, height, width, leaf_of, saliency.data()
+            );
+        });
+    });
+    return saliency;
+}
+
+
+/**
+ * Computes the ultrametric contour map (saliency) of the hierarchies
+ * compute_segmentation_hypotheses builds: every face between two
+ * foreground voxels of a component is given the level at which the
+ * hierarchy joins its two sides, and every voxel the largest level of its
+ * faces, so hypothesis boundaries light up at the level they vanish.
+ * Background voxels are zero. The merges are the ones of the Kruskal pass
+ * of `engine`, "kruskal" or "flood", in the same key order, so
+ * thresholding the map at a level gives the cuts of the hierarchy there.
+ * Other arguments match compute_segmentation_hypotheses; no hypothesis is
+ * built, so size and shape filters do not apply.
+ * Time complexity: O(n α(n)) after sorting the edges of each component
+ */
+template <typename T>
+nb::ndarray<nb::numpy, float> compute_saliency_map(
+    const nb::ndarray<nb::ro>& foreground,
+    const nb::ndarray<const T>& contours,
+    std::optional<int64_t> label,
+    bool compact_keys,
+    const std::string &edge_weight,
+    const std::string &engine
+) {
+    Engine parsed = parse_engine(engine);
+    if (parsed != Engine::KRUSKAL && parsed != Engine::FLOOD) {
+        throw std::invalid_argument("saliency maps support engine 'kruskal' or 'flood'");
+    }
+    if (foreground.ndim() != 3 || contours.ndim() != 3) {
+        throw std::invalid_argument("foreground and contours must be 3D arrays");
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (foreground.shape(i) != contours.shape(i)) {
+            throw std::invalid_argument("foreground and contours must have the same shape");
+        }
+    }
+
+    int depth = contours.shape(0);
+    int height = contours.shape(1);
+    int width = contours.shape(2);
+    int64_t strides[3] = {contours.stride(0), contours.stride(1), contours.stride(2)};
+
+    auto compute = [&](const auto &view) {
+        return with_edge_weight(view, edge_weight, [&](const auto &weight) {
+            return saliency_with_weight(foreground, label, weight, compact_keys, parsed);
+        });
+    };
+    std::vector<float> saliency = is_c_contiguous(contours)
+        ? compute(VolumeView<T, true>(contours.data(), strides, height, width))
+        : compute(VolumeView<T, false>(contours.data(), strides, height, width));
+    return to_ndarray(std::move(saliency), {
+        static_cast<size_t>(depth), static_cast<size_t>(height), static_cast<size_t>(width)
+    });
+}
@@ -1 +1 @@
-from .ultrack_td_ext import compute_segmentation_hypotheses, Segment, __doc__
\ No newline at end of file
+from .ultrack_td_ext import compute_segmentation_hypotheses, compute_affinity_hypotheses, compute_saliency_map, labels_to_contours, compute_conflict_edges, compute_overlaps, greedy_tracking, min_cost_flow_tracking, linear_assignment_tracking, compute_link_features, Segment, SpatialIndex, __doc__
\ No newline at end of file
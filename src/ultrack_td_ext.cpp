@@ -1,23 +1,94 @@
+#include <limits>
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
+#include <nanobind/stl/array.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
+#include "greedy_tracker.h"
+#include "label_contours.h"
+#include "linear_assignment.h"
+#include "link_features.h"
+#include "min_cost_flow.h"
+#include "overlap.h"
+#include "spatial_index.h"
 #include "ultrack.h"
 
 namespace nb = nanobind;
 
 using namespace nb::literals;
 
+template <typename T>
+void bind_segmentation_hypotheses(nb::module_ &m) {
+    m.def("compute_segmentation_hypotheses", compute_segmentation_hypotheses<T>, "foreground"_a, "contours"_a, "min_num_pixels"_a, "max_num_pixels"_a, "min_frontier"_a, "spacing"_a = Spacing{1.0f, 1.0f, 1.0f}, "min_sphericity"_a = 0.0f, "label"_a = nb::none(), "compact_keys"_a = false, "edge_weight"_a = "mean", "sigma"_a = 0.0f, "coarse_factor"_a = 1, "engine"_a = "kruskal", "attribute"_a = "altitude", "min_extinction"_a = 0.0f, "num_threads"_a = 0);
+}
+
+template <typename T>
+void bind_affinity_hypotheses(nb::module_ &m) {
+    m.def("compute_affinity_hypotheses", compute_affinity_hypotheses<T>, "foreground"_a, "affinities"_a, "min_num_pixels"_a, "max_num_pixels"_a, "min_frontier"_a, "spacing"_a = Spacing{1.0f, 1.0f, 1.0f}, "min_sphericity"_a = 0.0f, "label"_a = nb::none(), "compact_keys"_a = false, "coarse_factor"_a = 1, "engine"_a = "kruskal", "attribute"_a = "altitude", "min_extinction"_a = 0.0f, "num_threads"_a = 0);
+}
+
+template <typename T>
+void bind_saliency_map(nb::module_ &m) {
+    m.def("compute_saliency_map", compute_saliency_map<T>, "foreground"_a, "contours"_a, "label"_a = nb::none(), "compact_keys"_a = false, "edge_weight"_a = "mean", "engine"_a = "kruskal");
+}
+
 NB_MODULE(ultrack_td_ext, m) {
     m.doc() = "This is a \"hello world\" example with nanobind";
     nb::class_<Segment>(m, "Segment")
-    .def(nb::init<nb::ndarray<nb::numpy, bool>, nb::ndarray<nb::numpy, int>, int, int, int>())
+    .def("__init__", [](Segment *s, nb::ndarray<nb::numpy, bool> mask, nb::ndarray<nb::numpy, int> bbox, int num_pixels, int z, int y) {
+        new (s) Segment{mask, bbox, num_pixels, z, y};
+        s->x = bbox.data()[2 * bbox.stride(0)];
+        s->parent = -1;
+    })
     .def_prop_ro("mask", [](const Segment &s) -> nb::ndarray<nb::numpy, bool> { return s.mask; }, nb::rv_policy::reference)
     .def_prop_ro("bbox", [](const Segment &s) -> nb::ndarray<nb::numpy, int> { return s.bbox; }, nb::rv_policy::reference)
     .def_ro("num_pixels", &Segment::num_pixels)
     .def_ro("z", &Segment::z)
     .def_ro("y", &Segment::y)
-    .def_ro("x", &Segment::x);
+    .def_ro("x", &Segment::x)
+    .def_ro("volume", &Segment::volume)
+    .def_ro("centroid", &Segment::centroid)
+    .def_ro("moments", &Segment::moments)
+    .def_ro("area", &Segment::area)
+    .def_ro("score", &Segment::score)
+    .def_ro("parent", &Segment::parent);
+
+    // one overload per contour dtype, so inputs are never converted
+    bind_segmentation_hypotheses<float>(m);
+    bind_segmentation_hypotheses<double>(m);
+    bind_segmentation_hypotheses<Half>(m);
+    bind_segmentation_hypotheses<uint8_t>(m);
+    bind_segmentation_hypotheses<uint16_t>(m);
+
+    bind_affinity_hypotheses<float>(m);
+    bind_affinity_hypotheses<double>(m);
+    bind_affinity_hypotheses<Half>(m);
+    bind_affinity_hypotheses<uint8_t>(m);
+    bind_affinity_hypotheses<uint16_t>(m);
+
+    bind_saliency_map<float>(m);
+    bind_saliency_map<double>(m);
+    bind_saliency_map<Half>(m);
+    bind_saliency_map<uint8_t>(m);
+    bind_saliency_map<uint16_t>(m);
+
+    m.def("labels_to_contours", labels_to_contours, "labels"_a, "num_threads"_a = 0);
+    m.def("compute_conflict_edges", compute_conflict_edges, "segments"_a);
+    m.def("compute_overlaps", compute_overlaps, "segments_a"_a, "segments_b"_a, "pairs"_a = nb::none(), "num_threads"_a = 0);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    nb::class_<SpatialIndex>(m, "SpatialIndex")
+    .def_static("from_points", &SpatialIndex::from_points, "points"_a)
+    .def_static("from_segments", &SpatialIndex::from_segments, "segments"_a)
+    .def("__len__", &SpatialIndex::size)
+    .def("query_knn", &SpatialIndex::query_knn, "points"_a, "k"_a, "max_distance"_a = inf, "num_threads"_a = 0)
+    .def("query_knn", &SpatialIndex::query_knn_segments, "segments"_a, "k"_a, "max_distance"_a = inf, "num_threads"_a = 0)
+    .def("query_radius", &SpatialIndex::query_radius, "points"_a, "radius"_a, "num_threads"_a = 0)
+    .def("query_radius", &SpatialIndex::query_radius_segments, "segments"_a, "radius"_a, "num_threads"_a = 0);
 
-    m.def("compute_segmentation_hypotheses", compute_segmentation_hypotheses<float>, "foreground"_a, "contours"_a, "min_num_pixels"_a, "max_num_pixels"_a, "min_frontier"_a);
-    // TODO other types
+    m.def("greedy_tracking", greedy_tracking, "node_weights"_a, "conflicts"_a, "links"_a, "link_weights"_a, "division_weight"_a = 0.0f, "max_children"_a = 2);
+    m.def("min_cost_flow_tracking", min_cost_flow_tracking, "node_times"_a, "links"_a, "link_weights"_a, "appear_weight"_a = 0.0f, "disappear_weight"_a = 0.0f, "division_weight"_a = 0.0f, "max_children"_a = 2, "num_threads"_a = 0);
+    m.def("linear_assignment_tracking", linear_assignment_tracking, "node_times"_a, "links"_a, "link_weights"_a, "appear_weight"_a = 0.0f, "disappear_weight"_a = 0.0f, "num_threads"_a = 0);
+    m.def("compute_link_features", compute_link_features, "pairs"_a, "source_centroids"_a, "source_sizes"_a, "target_centroids"_a, "target_sizes"_a, "intersections"_a = nb::none(), "source_intensities"_a = nb::none(), "target_intensities"_a = nb::none(), "num_threads"_a = 0);
 }
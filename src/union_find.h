@@ -4,6 +4,7 @@
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
+#include <utility>
 
 /**
  * Tarjan's Union-Find (Disjoint Set Union) data structure
@@ -135,6 +136,21 @@ public:
         return find_internal(id_map[x]) == find_internal(id_map[y]);
     }
 
+    /**
+     * Find the internal index of the root of the set containing x,
+     * or -1 if x does not exist (it is NOT added).
+     * Internal indices follow insertion order, so they can address
+     * per-component arrays kept alongside the structure.
+     * Time complexity: O(α(n)) amortized
+     */
+    int find_index(int x) {
+        auto it = id_map.find(x);
+        if (it == id_map.end()) {
+            return -1;
+        }
+        return find_internal(it->second);
+    }
+
     /**
      * Get the size of the component containing x.
      * Time complexity: O(α(n)) amortized
@@ -249,4 +265,42 @@ private:
     }
 };
 
+
+/**
+ * Disjoint sets over the dense indices 0..n-1, e.g. the voxels or tree
+ * nodes of one component, with union by size and path halving.
+ */
+class DenseSets {
+private:
+    std::vector<int> parent;
+    std::vector<int> size;
+
+public:
+    explicit DenseSets(int n) : parent(n), size(n, 1) {
+        for (int i = 0; i < n; i++) {
+            parent[i] = i;
+        }
+    }
+
+    int find(int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    /**
+     * Joins the sets of two roots and returns the new root.
+     */
+    int unite_roots(int a, int b) {
+        if (size[a] < size[b]) {
+            std::swap(a, b);
+        }
+        parent[b] = a;
+        size[a] += size[b];
+        return a;
+    }
+};
+
 #endif // UNION_FIND_H
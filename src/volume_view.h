@@ -0,0 +1,59 @@
+#ifndef VOLUME_VIEW_H
+#define VOLUME_VIEW_H
+
+#include <cstdint>
+
+/**
+ * Read-only view of a 3D array addressed by C-order linear voxel indices,
+ * i.e. z * height * width + y * width + x, whatever its memory layout.
+ *
+ * Contiguous views read data[idx] directly. Strided views, e.g. slices of
+ * a larger array or Fortran-ordered arrays, recover (z, y, x) from the
+ * index and apply the element strides, so inputs are never copied.
+ */
+template <typename T, bool Contiguous>
+class VolumeView {
+private:
+    const T *data;
+    int64_t strides[3];  // in elements, possibly negative
+    int height;
+    int width;
+
+public:
+    using value_type = T;
+
+    VolumeView(const T *data, const int64_t *strides, int height, int width)
+        : data(data), strides{strides[0], strides[1], strides[2]}, height(height), width(width) {}
+
+    T operator[](int idx) const {
+        if constexpr (Contiguous) {
+            return data[idx];
+        } else {
+            int plane = height * width;
+            int z = idx / plane;
+            int rest = idx - z * plane;
+            int y = rest / width;
+            int x = rest - y * width;
+            return data[z * strides[0] + y * strides[1] + x * strides[2]];
+        }
+    }
+};
+
+
+/**
+ * True if the array is laid out in C order, ignoring the strides of
+ * singleton axes, which are never used to address an element.
+ */
+template <typename Array>
+bool is_c_contiguous(const Array &array) {
+    int64_t expected = 1;
+    for (size_t i = array.ndim(); i-- > 0;) {
+        if (array.shape(i) != 1 && array.stride(i) != expected) {
+            return false;
+        }
+        expected *= static_cast<int64_t>(array.shape(i));
+    }
+    return true;
+}
+
+#endif // VOLUME_VIEW_H
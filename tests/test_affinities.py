@@ -0,0 +1,58 @@
+import numpy as np
+import pytest
+
+from ultrack_td import compute_affinity_hypotheses, compute_segmentation_hypotheses
+
+from test_hypotheses import LINE, distinct_sums, voxels
+
+
+def mean_affinities(contours):
+    """Per-axis affinities whose complements are the "mean" edge weights of `contours`."""
+    affinities = np.zeros((3,) + contours.shape, dtype=contours.dtype)
+    for axis in range(3):
+        lower = [slice(None)] * 3
+        upper = [slice(None)] * 3
+        lower[axis] = slice(None, -1)
+        upper[axis] = slice(1, None)
+        # channel `axis` of a voxel links it to its predecessor along that axis
+        affinities[(axis,) + tuple(upper)] = 1 - (contours[tuple(upper)] + contours[tuple(lower)]) / 2
+    return affinities
+
+
+@pytest.mark.parametrize("axis", [0, 1, 2])
+def test_line_matches_mean_contours(axis):
+    # the two other axes are singletons
+    shape = [1, 1, 1]
+    shape[axis] = len(LINE)
+    contours = (np.array(LINE, dtype=np.float32) / 8).reshape(shape)
+    foreground = np.ones(contours.shape, dtype=bool)
+    reference = compute_segmentation_hypotheses(foreground, contours, 0, 100, 0, edge_weight="mean")
+
+    segments = compute_affinity_hypotheses(foreground, mean_affinities(contours), 0, 100, 0)
+
+    assert len(segments) == len(LINE) - 1
+    assert [voxels(s, contours.shape) for s in segments] == [voxels(s, contours.shape) for s in reference]
+    assert [s.parent for s in segments] == [s.parent for s in reference]
+
+
+def test_volume_matches_mean_contours():
+    # multiples of 1 / 4096, so the affinities and their complements are exact
+    contours = (distinct_sums((3, 5, 6), 256, np.random.default_rng(0)) / 4096).astype(np.float32)
+    foreground = np.ones(contours.shape, dtype=bool)
+    foreground[1, 2, :3] = False
+    reference = compute_segmentation_hypotheses(foreground, contours, 2, 100, 0, edge_weight="mean")
+
+    segments = compute_affinity_hypotheses(foreground, mean_affinities(contours), 2, 100, 0)
+
+    shape = contours.shape
+    assert len(segments) > 10
+    assert [voxels(s, shape) for s in segments] == [voxels(s, shape) for s in reference]
+    assert [s.parent for s in segments] == [s.parent for s in reference]
+
+
+def test_mismatched_shapes():
+    foreground = np.ones((2, 3, 4), dtype=bool)
+    with pytest.raises(ValueError):
+        compute_affinity_hypotheses(foreground, np.zeros((3, 2, 3, 5), dtype=np.float32), 0, 10, 0)
+    with pytest.raises(ValueError):
+        compute_affinity_hypotheses(foreground, np.zeros((2, 2, 3, 4), dtype=np.float32), 0, 10, 0)
@@ -0,0 +1,67 @@
+import numpy as np
+import pytest
+
+from ultrack_td import compute_segmentation_hypotheses
+
+
+# two basins, {0..4} at depth 0 under the saddle of voxel 5 and {7, 8} under
+# voxel 6; with mean edge weights the smaller one fills {6, 7, 8} at level 6
+# and they join at level 10
+LINE = [0, 0, 0, 0, 0, 8, 12, 0, 0]
+BASINS = [set(range(6)), {6, 7, 8}, set(range(9))]
+
+# extinction values of the join, with unit spacing:
+# the weaker side's area 3, lake volume 2 * 6 + 3 * (10 - 6) = 24 and depth 10
+EXTINCTIONS = [("area", 3.0), ("volume", 24.0), ("dynamics", 10.0)]
+ENGINES = ["kruskal", "basins", "flood"]
+
+
+def voxels(segment):
+    """x coordinates of the voxels of a segment of the line."""
+    return set((np.flatnonzero(segment.mask) + segment.bbox[2]).tolist())
+
+
+def hypotheses(attribute, min_extinction, engine, spacing=(1, 1, 1)):
+    contours = np.array(LINE, dtype=np.float32).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+    return compute_segmentation_hypotheses(
+        foreground, contours, 0, 100, -1, spacing=spacing, attribute=attribute,
+        min_extinction=min_extinction, engine=engine
+    )
+
+
+@pytest.mark.parametrize("engine", ENGINES)
+@pytest.mark.parametrize("attribute, extinction", EXTINCTIONS)
+def test_attribute_hierarchies_emit_basins(engine, attribute, extinction):
+    kept = hypotheses(attribute, extinction - 0.1, engine)
+    pruned = hypotheses(attribute, extinction, engine)
+
+    assert [voxels(s) for s in kept] == BASINS
+    assert [s.parent for s in kept] == [2, 2, -1]
+    assert [voxels(s) for s in pruned] == BASINS[2:]
+    assert [s.parent for s in pruned] == [-1]
+
+
+@pytest.mark.parametrize("attribute, extinction", EXTINCTIONS)
+def test_extinctions_are_physical(attribute, extinction):
+    # doubling the x spacing doubles areas and volumes, not depths
+    scale = 1.0 if attribute == "dynamics" else 2.0
+
+    kept = hypotheses(attribute, scale * extinction - 0.1, "kruskal", spacing=(1, 1, 2))
+    pruned = hypotheses(attribute, scale * extinction, "kruskal", spacing=(1, 1, 2))
+
+    assert len(kept) == 3
+    assert len(pruned) == 1
+
+
+@pytest.mark.parametrize("engine", ENGINES)
+def test_altitude_ignores_min_extinction(engine):
+    segments = hypotheses("altitude", 100.0, engine)
+
+    assert len(segments) == 8
+    assert {frozenset(voxels(s)) for s in segments} >= {frozenset(b) for b in BASINS}
+
+
+def test_unknown_attribute():
+    with pytest.raises(ValueError):
+        hypotheses("perimeter", 0.0, "kruskal")
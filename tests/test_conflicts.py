@@ -0,0 +1,57 @@
+import numpy as np
+import pytest
+
+from ultrack_td import Segment, compute_conflict_edges, compute_segmentation_hypotheses
+
+
+def voxels(segment, shape):
+    """Flat indices of the voxels of a segment in a volume of `shape`."""
+    full = np.zeros(shape, dtype=bool)
+    z0, y0, x0, z1, y1, x1 = segment.bbox
+    full[z0:z1 + 1, y0:y1 + 1, x0:x1 + 1] = segment.mask
+    return frozenset(np.flatnonzero(full).tolist())
+
+
+def hypotheses():
+    rng = np.random.default_rng(0)
+    contours = rng.random((4, 10, 10), dtype=np.float32)
+    foreground = contours < 0.8
+    segments = compute_segmentation_hypotheses(foreground, contours, 1, 60, 0)
+    return segments, [voxels(s, contours.shape) for s in segments]
+
+
+def test_parents_are_smallest_later_supersets():
+    segments, sets = hypotheses()
+
+    for i, s in enumerate(segments):
+        supersets = [j for j in range(i + 1, len(sets)) if sets[i] < sets[j]]
+        if s.parent < 0:
+            assert not supersets
+        else:
+            assert s.parent == min(supersets, key=lambda j: len(sets[j]))
+
+
+def test_conflict_edges_match_overlapping_pairs():
+    segments, sets = hypotheses()
+
+    edges = compute_conflict_edges(segments)
+
+    expected = {(j, i) for i in range(len(sets)) for j in range(i + 1, len(sets)) if sets[i] & sets[j]}
+    assert edges.shape == (len(expected), 2)
+    assert {tuple(e) for e in edges.tolist()} == expected
+
+
+def test_conflict_edges_reject_reordered_lists():
+    segments, _ = hypotheses()
+    with pytest.raises(ValueError):
+        compute_conflict_edges(segments[::-1])
+
+
+def test_constructed_segment_has_no_parent():
+    mask = np.ones((1, 2, 2), dtype=bool)
+    bbox = np.array([0, 0, 0, 0, 1, 1], dtype=np.int32)
+
+    segment = Segment(mask, bbox, 4, 0, 0)
+
+    assert segment.parent == -1
+    assert compute_conflict_edges([segment]).shape == (0, 2)
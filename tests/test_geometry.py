@@ -0,0 +1,71 @@
+import numpy as np
+import pytest
+
+from ultrack_td import compute_segmentation_hypotheses
+
+from test_hypotheses import LINE, LINE_HYPOTHESES, voxels
+
+
+def box_segment(shape, box, spacing):
+    """The single hypothesis of a foreground box with flat contours."""
+    foreground = np.zeros(shape, dtype=bool)
+    foreground[box] = True
+    contours = np.zeros(shape, dtype=np.float32)
+    segments = compute_segmentation_hypotheses(foreground, contours, 0, 1000, 0, spacing=spacing)
+    assert len(segments) == 1
+    return segments[0]
+
+
+def test_box_geometry_is_physical():
+    # 2 x 3 x 4 voxels of volume 2 * 1 * 0.5
+    segment = box_segment((4, 6, 9), np.s_[1:3, 2:5, 3:7], (2.0, 1.0, 0.5))
+
+    assert segment.num_pixels == 24
+    assert segment.volume == pytest.approx(24 * 1.0)
+    assert segment.centroid == pytest.approx([1.5 * 2.0, 3.0 * 1.0, 4.5 * 0.5])
+    # variances of k consecutive indices are (k^2 - 1) / 12, scaled by the spacing squared
+    zz = (2 ** 2 - 1) / 12 * 2.0 ** 2
+    yy = (3 ** 2 - 1) / 12 * 1.0 ** 2
+    xx = (4 ** 2 - 1) / 12 * 0.5 ** 2
+    np.testing.assert_allclose(segment.moments, [zz, 0, 0, yy, 0, xx], atol=1e-6)
+
+
+def test_size_limits_are_physical():
+    # voxels of volume 8, so the hypotheses of 2 to 7 voxels weigh 16 to 56
+    contours = np.array(LINE, dtype=np.float32).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 20, 50, 0, spacing=(2.0, 2.0, 2.0))
+
+    assert [voxels(s, contours.shape) for s in segments] == LINE_HYPOTHESES[1:5]
+    assert [s.volume for s in segments] == [8.0 * len(h) for h in LINE_HYPOTHESES[1:5]]
+
+
+@pytest.mark.parametrize("spacing, area", [((1.0, 1.0, 1.0), 24.0), ((2.0, 1.0, 0.5), 8 * 0.5 + 8 * 1.0 + 8 * 2.0)])
+def test_cube_area(spacing, area):
+    # 8 faces along each axis, of area the product of the two other spacings
+    segment = box_segment((4, 4, 4), np.s_[1:3, 1:3, 1:3], spacing)
+
+    assert segment.area == pytest.approx(area)
+
+
+def test_min_sphericity_drops_elongated_hypotheses():
+    # the sphericity of a line of n voxels decreases with n, below 0.7 from 4 voxels on
+    contours = np.array(LINE, dtype=np.float32).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 0, 100, 0, min_sphericity=0.7)
+
+    assert [voxels(s, contours.shape) for s in segments] == LINE_HYPOTHESES[:2]
+
+
+def test_min_sphericity_keeps_compact_hypotheses():
+    # a 2 x 2 x 2 cube is more spherical than any of its parts
+    contours = np.arange(8, dtype=np.float32).reshape(2, 2, 2)
+    foreground = np.ones(contours.shape, dtype=bool)
+    every = compute_segmentation_hypotheses(foreground, contours, 0, 100, 0)
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 0, 100, 0, min_sphericity=0.8)
+
+    assert len(every) > 1
+    assert [voxels(s, contours.shape) for s in segments] == [frozenset(range(8))]
@@ -0,0 +1,289 @@
+import numpy as np
+import pytest
+
+from ultrack_td import compute_segmentation_hypotheses
+
+
+DTYPES = [np.float32, np.float64, np.float16, np.uint8, np.uint16]
+
+# engine, edge weight; "tree" keys voxels and needs "max"
+ENGINES = [("kruskal", "mean"), ("kruskal", "max"), ("basins", "mean"), ("basins", "max"),
+           ("flood", "mean"), ("flood", "max"), ("tree", "max")]
+
+# contours of a single line of voxels, lowest in the middle
+LINE = [5, 3, 1, 0, 2, 4, 6]
+LINE_HYPOTHESES = [{2, 3}, {2, 3, 4}, {1, 2, 3, 4}, {1, 2, 3, 4, 5}, {0, 1, 2, 3, 4, 5}, set(range(7))]
+
+
+def voxels(segment, shape):
+    """Flat indices of the voxels of a segment in a volume of `shape`."""
+    full = np.zeros(shape, dtype=bool)
+    z0, y0, x0, z1, y1, x1 = segment.bbox
+    full[z0:z1 + 1, y0:y1 + 1, x0:x1 + 1] = segment.mask
+    return frozenset(np.flatnonzero(full).tolist())
+
+
+@pytest.mark.parametrize("dtype", DTYPES)
+@pytest.mark.parametrize("engine, edge_weight", ENGINES)
+def test_line_hypotheses(dtype, engine, edge_weight):
+    contours = np.array(LINE, dtype=dtype).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+
+    segments = compute_segmentation_hypotheses(
+        foreground, contours, 0, 100, 0, edge_weight=edge_weight, engine=engine
+    )
+
+    assert [voxels(s, contours.shape) for s in segments] == LINE_HYPOTHESES
+    assert [s.num_pixels for s in segments] == [len(h) for h in LINE_HYPOTHESES]
+    # each hypothesis is the child of the next one
+    assert [s.parent for s in segments] == [1, 2, 3, 4, 5, -1]
+
+
+# mean boundary weight of LINE_HYPOTHESES: only faces along x are in the volume,
+# so {0, ..., 5} touching the border is scored by its face to voxel 6 alone
+LINE_SCORES = {
+    "mean": [(2 + 1) / 2, (2 + 3) / 2, (4 + 3) / 2, (4 + 5) / 2, 5, 0],
+    "max": [(3 + 2) / 2, (3 + 4) / 2, (5 + 4) / 2, (5 + 6) / 2, 6, 0],
+}
+
+
+@pytest.mark.parametrize("edge_weight", ["mean", "max"])
+def test_line_scores(edge_weight):
+    contours = np.array(LINE, dtype=np.float32).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 0, 100, 0, edge_weight=edge_weight)
+
+    assert [voxels(s, contours.shape) for s in segments] == LINE_HYPOTHESES
+    assert [s.score for s in segments] == pytest.approx(LINE_SCORES[edge_weight])
+
+
+# edge weight, contours and expected hypotheses with their parents; "min" ties
+# the two faces of voxel 3 at 0, which emit nothing, and "absdiff" merges
+# the faces by increasing steps 1, 2, 3, 4, 5, 6
+OTHER_WEIGHTS = [
+    ("min", LINE, [{1, 2, 3, 4}, {1, 2, 3, 4, 5}, {0, 1, 2, 3, 4, 5}, set(range(7))], [1, 2, 3, -1]),
+    ("absdiff", [0, 5, 7, 8, 12, 18, 21],
+     [{2, 3}, {1, 2, 3}, {5, 6}, {1, 2, 3, 4}, {0, 1, 2, 3, 4}, set(range(7))], [1, 3, 5, 4, 5, -1]),
+]
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.uint8])
+@pytest.mark.parametrize("engine", ["kruskal", "basins", "flood"])
+@pytest.mark.parametrize("edge_weight, line, hypotheses, parents", OTHER_WEIGHTS)
+def test_line_other_weights(dtype, engine, edge_weight, line, hypotheses, parents):
+    contours = np.array(line, dtype=dtype).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+
+    segments = compute_segmentation_hypotheses(
+        foreground, contours, 0, 100, 0, edge_weight=edge_weight, engine=engine
+    )
+
+    assert [voxels(s, contours.shape) for s in segments] == hypotheses
+    assert [s.parent for s in segments] == parents
+
+
+def distinct_sums(shape, high, rng):
+    """Values below `high` whose sums over neighboring voxels are all distinct,
+    so every engine sees the same merge order whatever the dtype."""
+    values = np.zeros(shape, dtype=np.int64)
+    used = set()
+    for z, y, x in np.ndindex(shape):
+        previous = [values[p] for p in [(z - 1, y, x), (z, y - 1, x), (z, y, x - 1)] if min(p) >= 0]
+        for v in rng.permutation(high):
+            sums = [v + p for p in previous]
+            if len(set(sums)) == len(sums) and not used.intersection(sums):
+                used.update(sums)
+                values[z, y, x] = v
+                break
+        else:
+            raise ValueError("no values with distinct sums below high")
+    return values
+
+
+@pytest.mark.parametrize("dtype", DTYPES)
+def test_dtypes_agree(dtype):
+    values = distinct_sums((3, 5, 6), 256, np.random.default_rng(0))
+    foreground = np.ones(values.shape, dtype=bool)
+    foreground[1, 2, :3] = False
+    reference = compute_segmentation_hypotheses(foreground, values.astype(np.float64), 2, 100, 0)
+
+    segments = compute_segmentation_hypotheses(foreground, values.astype(dtype), 2, 100, 0)
+
+    shape = values.shape
+    assert len(segments) > 10
+    assert [voxels(s, shape) for s in segments] == [voxels(s, shape) for s in reference]
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.float64, np.float16, np.uint16])
+def test_compact_keys_match_exact_keys(dtype):
+    # means of sums below 512 are multiples of 0.5 below 256, exact in 16-bit keys
+    values = distinct_sums((3, 5, 6), 256, np.random.default_rng(0))
+    foreground = np.ones(values.shape, dtype=bool)
+    foreground[1, 2, :3] = False
+    reference = compute_segmentation_hypotheses(foreground, values.astype(np.float64), 2, 100, 0)
+
+    segments = compute_segmentation_hypotheses(foreground, values.astype(dtype), 2, 100, 0, compact_keys=True)
+
+    shape = values.shape
+    assert len(segments) > 10
+    assert [voxels(s, shape) for s in segments] == [voxels(s, shape) for s in reference]
+    assert [s.parent for s in segments] == [s.parent for s in reference]
+    np.testing.assert_allclose([s.score for s in segments], [s.score for s in reference], rtol=1e-6)
+
+
+@pytest.mark.parametrize("compact_keys", [False, True])
+def test_flood_matches_basins(compact_keys):
+    # both merge every face of a component in ascending order
+    values = distinct_sums((4, 6, 7), 2048, np.random.default_rng(1)).astype(np.float32)
+    foreground = values < 1600
+    basins = compute_segmentation_hypotheses(foreground, values, 0, 1000, 0, compact_keys=compact_keys, engine="basins")
+
+    flood = compute_segmentation_hypotheses(foreground, values, 0, 1000, 0, compact_keys=compact_keys, engine="flood")
+
+    shape = values.shape
+    assert [voxels(s, shape) for s in flood] == [voxels(s, shape) for s in basins]
+    assert [s.parent for s in flood] == [s.parent for s in basins]
+    np.testing.assert_allclose([s.score for s in flood], [s.score for s in basins], rtol=1e-5)
+
+
+def test_tree_components_are_flood_hypotheses():
+    # voxel values are distinct, so the only ties are faces keyed by the same voxel,
+    # and every component of the tree is a hypothesis of any Kruskal order
+    rng = np.random.default_rng(2)
+    contours = rng.permutation(5 * 12 * 12).reshape(5, 12, 12).astype(np.float32)
+    foreground = contours < 600
+    flood = compute_segmentation_hypotheses(foreground, contours, 1, 1000, 0, edge_weight="max", engine="flood")
+
+    tree = compute_segmentation_hypotheses(foreground, contours, 1, 1000, 0, edge_weight="max", engine="tree")
+
+    shape = contours.shape
+    assert len(tree) > 10
+    assert {voxels(s, shape) for s in tree} <= {voxels(s, shape) for s in flood}
+
+
+def test_parallel_tree_matches_serial():
+    # 2^15 voxels per slab, so two threads build and merge two slabs
+    rng = np.random.default_rng(3)
+    contours = rng.random((8, 64, 128), dtype=np.float32)
+    foreground = np.ones(contours.shape, dtype=bool)
+    serial = compute_segmentation_hypotheses(
+        foreground, contours, 20, 2000, 0, edge_weight="max", engine="tree", num_threads=1
+    )
+
+    parallel = compute_segmentation_hypotheses(
+        foreground, contours, 20, 2000, 0, edge_weight="max", engine="tree", num_threads=2
+    )
+
+    shape = contours.shape
+    assert len(serial) > 100
+    assert {voxels(s, shape) for s in parallel} == {voxels(s, shape) for s in serial}
+
+
+def test_tree_requirements():
+    contours = np.zeros((1, 1, 4), dtype=np.float32)
+    with pytest.raises(ValueError):
+        compute_segmentation_hypotheses(contours > -1, contours, 0, 10, 0, edge_weight="mean", engine="tree")
+    with pytest.raises(ValueError):
+        compute_segmentation_hypotheses(contours > -1, contours, 0, 10, 0, edge_weight="max", engine="tree", attribute="area")
+
+
+def test_size_limits_are_exclusive():
+    contours = np.array(LINE, dtype=np.float32).reshape(1, 1, -1)
+    foreground = np.ones(contours.shape, dtype=bool)
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 3, 6, 0)
+
+    assert [voxels(s, contours.shape) for s in segments] == LINE_HYPOTHESES[2:4]
+
+
+def test_sigma_blurs_in_physical_units():
+    ndimage = pytest.importorskip("scipy.ndimage")
+    rng = np.random.default_rng(5)
+    contours = rng.random((6, 12, 14), dtype=np.float32)
+    foreground = np.ones(contours.shape, dtype=bool)
+    spacing = (2.0, 1.0, 0.5)
+    sigma = 1.5
+    blurred = ndimage.gaussian_filter(contours, sigma / np.array(spacing))
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 2, 500, 0, spacing=spacing, sigma=sigma)
+
+    reference = compute_segmentation_hypotheses(foreground, blurred, 2, 500, 0, spacing=spacing)
+    shape = contours.shape
+    assert len(segments) > 10
+    assert [voxels(s, shape) for s in segments] == [voxels(s, shape) for s in reference]
+    np.testing.assert_allclose([s.score for s in segments], [s.score for s in reference], rtol=1e-4)
+
+
+@pytest.mark.parametrize("engine, edge_weight", ENGINES)
+def test_coarse_factor_matches_fine(engine, edge_weight):
+    # smooth blocks only hold edges below min_frontier, which emit nothing
+    rng = np.random.default_rng(4)
+    contours = rng.random((8, 16, 16), dtype=np.float32)
+    contours[:, :8, :8] = 0.05 * rng.random((8, 8, 8))
+    contours[2:6, 8:, 8:] = 0
+    foreground = np.ones(contours.shape, dtype=bool)
+    foreground[:, :, 14:] = False
+    fine = compute_segmentation_hypotheses(foreground, contours, 2, 400, 0.1, edge_weight=edge_weight, engine=engine)
+
+    coarse = compute_segmentation_hypotheses(
+        foreground, contours, 2, 400, 0.1, edge_weight=edge_weight, engine=engine, coarse_factor=4
+    )
+
+    shape = contours.shape
+    assert len(fine) > 10
+    assert [voxels(s, shape) for s in coarse] == [voxels(s, shape) for s in fine]
+    assert [s.parent for s in coarse] == [s.parent for s in fine]
+
+
+@pytest.mark.parametrize("dtype", [np.uint8, np.int32, np.uint16])
+@pytest.mark.parametrize("label", [2, 3])
+def test_label_matches_boolean_mask(dtype, label):
+    rng = np.random.default_rng(6)
+    contours = rng.random((4, 10, 12), dtype=np.float32)
+    labels = rng.integers(0, 4, (4, 5, 6)).repeat(2, axis=1).repeat(2, axis=2)
+    reference = compute_segmentation_hypotheses(labels == label, contours, 1, 100, 0)
+
+    segments = compute_segmentation_hypotheses(labels.astype(dtype), contours, 1, 100, 0, label=label)
+
+    shape = contours.shape
+    assert len(segments) > 10
+    assert [voxels(s, shape) for s in segments] == [voxels(s, shape) for s in reference]
+    assert [s.parent for s in segments] == [s.parent for s in reference]
+
+
+@pytest.mark.parametrize("dtype, label", [(np.uint8, 256), (np.uint8, -1), (np.uint16, 65536), (np.int32, 2 ** 31)])
+def test_label_out_of_range(dtype, label):
+    contours = np.zeros((1, 2, 2), dtype=np.float32)
+    with pytest.raises(ValueError):
+        compute_segmentation_hypotheses(np.ones(contours.shape, dtype=dtype), contours, 0, 10, 0, label=label)
+
+
+@pytest.mark.parametrize("layout", ["strided", "fortran", "foreground"])
+def test_views_match_contiguous_arrays(layout):
+    rng = np.random.default_rng(7)
+    volume = rng.random((4, 12, 9), dtype=np.float32)
+    mask = rng.random((4, 12, 18)) < 0.8
+    if layout == "strided":
+        contours, foreground = volume[:, ::2, ::-1], np.ones((4, 6, 9), dtype=bool)
+    elif layout == "fortran":
+        contours, foreground = np.asfortranarray(volume), np.asfortranarray(mask[:, :, :9])
+    else:
+        contours, foreground = volume, mask[:, :, ::2]
+    reference = compute_segmentation_hypotheses(
+        np.ascontiguousarray(foreground), np.ascontiguousarray(contours), 1, 100, 0
+    )
+
+    segments = compute_segmentation_hypotheses(foreground, contours, 1, 100, 0)
+
+    shape = contours.shape
+    assert len(segments) > 10
+    assert [voxels(s, shape) for s in segments] == [voxels(s, shape) for s in reference]
+    assert [s.parent for s in segments] == [s.parent for s in reference]
+    assert [s.score for s in segments] == [s.score for s in reference]
+
+
+def test_unknown_engine():
+    contours = np.zeros((1, 1, 4), dtype=np.float32)
+    with pytest.raises(ValueError):
+        compute_segmentation_hypotheses(contours > -1, contours, 0, 10, 0, engine="unknown")
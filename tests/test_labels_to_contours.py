@@ -0,0 +1,62 @@
+import numpy as np
+import pytest
+
+from ultrack_td import labels_to_contours
+
+
+def boundaries(label):
+    """Voxels with a face-adjacent voxel of another label, background included."""
+    boundary = np.zeros(label.shape, dtype=bool)
+    for axis in range(3):
+        differs = np.diff(label, axis=axis) != 0
+        lower = [slice(None)] * 3
+        upper = [slice(None)] * 3
+        lower[axis] = slice(None, -1)
+        upper[axis] = slice(1, None)
+        boundary[tuple(lower)] |= differs
+        boundary[tuple(upper)] |= differs
+    return boundary
+
+
+def random_labels(rng, shape, num_labels):
+    # blocky labels, so that boundaries are a minority of the voxels
+    coarse = rng.integers(0, num_labels, (shape[0], shape[1] // 2, shape[2] // 3))
+    return coarse.repeat(2, axis=1).repeat(3, axis=2)
+
+
+def test_labels_to_contours_matches_numpy():
+    rng = np.random.default_rng(0)
+    shape = (5, 12, 18)
+    labels = [
+        random_labels(rng, shape, 4).astype(np.uint8),
+        random_labels(rng, shape, 300).astype(np.uint16),
+        -random_labels(rng, shape, 5).astype(np.int32),
+        random_labels(rng, shape, 7).astype(np.int64),
+        random_labels(rng, shape, 2).astype(bool),
+    ]
+
+    foreground, contours = labels_to_contours(labels, num_threads=2)
+
+    np.testing.assert_array_equal(foreground, np.any([l != 0 for l in labels], axis=0))
+    expected = np.mean([boundaries(l) for l in labels], axis=0)
+    np.testing.assert_allclose(contours, expected, rtol=1e-6)
+
+
+def test_strided_labels():
+    rng = np.random.default_rng(1)
+    label = random_labels(rng, (6, 12, 9), 5).astype(np.uint16)
+    view = label.transpose(2, 1, 0)[:, ::2]
+
+    foreground, contours = labels_to_contours([view])
+
+    np.testing.assert_array_equal(foreground, view != 0)
+    np.testing.assert_array_equal(contours, boundaries(view).astype(np.float32))
+
+
+def test_labels_to_contours_rejects_invalid_inputs():
+    with pytest.raises(ValueError):
+        labels_to_contours([])
+    with pytest.raises(ValueError):
+        labels_to_contours([np.zeros((2, 3, 4), dtype=np.uint8), np.zeros((2, 3, 5), dtype=np.uint8)])
+    with pytest.raises(ValueError):
+        labels_to_contours([np.zeros((2, 3, 4), dtype=np.float32)])
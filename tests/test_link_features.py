@@ -0,0 +1,68 @@
+import numpy as np
+import pytest
+
+from ultrack_td import compute_link_features
+
+
+def tables(seed, num_sources=300, num_targets=250, num_pairs=10000):
+    """Attribute tables of two frames and candidate pairs, spanning several blocks."""
+    rng = np.random.default_rng(seed)
+    return dict(
+        pairs=np.stack([rng.integers(0, num_sources, num_pairs), rng.integers(0, num_targets, num_pairs)],
+                       axis=1).astype(np.int32),
+        source_centroids=rng.uniform(0, 100, (num_sources, 3)).astype(np.float32),
+        source_sizes=rng.integers(1, 500, num_sources).astype(np.float32),
+        target_centroids=rng.uniform(0, 100, (num_targets, 3)).astype(np.float32),
+        target_sizes=rng.integers(1, 500, num_targets).astype(np.float32),
+    )
+
+
+def reference(pairs, source_centroids, source_sizes, target_centroids, target_sizes,
+              intersections=None, source_intensities=None, target_intensities=None):
+    s, t = pairs[:, 0], pairs[:, 1]
+    distance = np.linalg.norm(source_centroids[s] - target_centroids[t], axis=1)
+    a, b = source_sizes[s], target_sizes[t]
+    if intersections is None:
+        iou = np.full(len(pairs), np.nan)
+    else:
+        iou = intersections / (a + b - intersections)
+    ratio = np.minimum(a, b) / np.maximum(a, b)
+    if source_intensities is None:
+        diff = np.full(len(pairs), np.nan)
+    else:
+        diff = np.abs(source_intensities[s] - target_intensities[t])
+    return np.stack([distance, iou, ratio, diff])
+
+
+def test_link_features_match_numpy():
+    inputs = tables(0)
+    rng = np.random.default_rng(1)
+    s, t = inputs["pairs"][:, 0], inputs["pairs"][:, 1]
+    smaller = np.minimum(inputs["source_sizes"][s], inputs["target_sizes"][t]).astype(np.int64)
+    inputs["intersections"] = rng.integers(0, smaller + 1)
+    inputs["source_intensities"] = rng.random(len(inputs["source_sizes"]), dtype=np.float32)
+    inputs["target_intensities"] = rng.random(len(inputs["target_sizes"]), dtype=np.float32)
+
+    features = compute_link_features(**inputs, num_threads=2)
+
+    assert features.shape == (4, len(inputs["pairs"]))
+    np.testing.assert_allclose(features, reference(**inputs), rtol=1e-5, atol=1e-6)
+
+
+def test_missing_inputs_give_nan_rows():
+    inputs = tables(2)
+
+    features = compute_link_features(**inputs)
+
+    expected = reference(**inputs)
+    assert np.isnan(features[1]).all() and np.isnan(features[3]).all()
+    np.testing.assert_allclose(features[[0, 2]], expected[[0, 2]], rtol=1e-5)
+
+
+def test_link_features_reject_invalid_inputs():
+    inputs = tables(3, num_pairs=10)
+    with pytest.raises(ValueError):
+        compute_link_features(**inputs, source_intensities=np.ones(len(inputs["source_sizes"]), dtype=np.float32))
+    inputs["pairs"][0, 1] = len(inputs["target_sizes"])
+    with pytest.raises(IndexError):
+        compute_link_features(**inputs)
@@ -0,0 +1,82 @@
+import numpy as np
+import pytest
+
+from ultrack_td import Segment, compute_overlaps, compute_segmentation_hypotheses
+
+
+def voxels(segment, shape):
+    """Flat indices of the voxels of a segment in a volume of `shape`."""
+    full = np.zeros(shape, dtype=bool)
+    z0, y0, x0, z1, y1, x1 = segment.bbox
+    full[z0:z1 + 1, y0:y1 + 1, x0:x1 + 1] = segment.mask
+    return frozenset(np.flatnonzero(full).tolist())
+
+
+SHAPE = (3, 12, 12)
+
+
+def frame(seed):
+    rng = np.random.default_rng(seed)
+    contours = rng.random(SHAPE, dtype=np.float32)
+    segments = compute_segmentation_hypotheses(contours < 0.7, contours, 2, 40, 0)
+    return segments, [voxels(s, SHAPE) for s in segments]
+
+
+def test_overlaps_match_brute_force():
+    segments_a, sets_a = frame(0)
+    segments_b, sets_b = frame(1)
+
+    pairs, intersection, iou = compute_overlaps(segments_a, segments_b, num_threads=2)
+
+    expected = {
+        (i, j): len(a & b)
+        for i, a in enumerate(sets_a)
+        for j, b in enumerate(sets_b)
+        if a & b
+    }
+    assert len(expected) > 0
+    assert [tuple(p) for p in pairs.tolist()] == sorted(expected)
+    assert intersection.tolist() == [expected[tuple(p)] for p in pairs.tolist()]
+    union = [len(sets_a[i]) + len(sets_b[j]) - expected[(i, j)] for i, j in pairs.tolist()]
+    np.testing.assert_allclose(iou, intersection / np.array(union), rtol=1e-6)
+
+
+def test_overlaps_of_given_pairs():
+    segments_a, sets_a = frame(0)
+    segments_b, sets_b = frame(1)
+    rng = np.random.default_rng(2)
+    pairs = np.stack([
+        rng.integers(0, len(segments_a), 50), rng.integers(0, len(segments_b), 50)
+    ], axis=1).astype(np.int32)
+
+    out_pairs, intersection, iou = compute_overlaps(segments_a, segments_b, pairs)
+
+    np.testing.assert_array_equal(out_pairs, pairs)
+    expected = [len(sets_a[i] & sets_b[j]) for i, j in pairs.tolist()]
+    union = [len(sets_a[i] | sets_b[j]) for i, j in pairs.tolist()]
+    assert intersection.tolist() == expected
+    np.testing.assert_allclose(iou, np.array(expected) / np.array(union), rtol=1e-6)
+
+
+def test_overlaps_reject_invalid_pairs():
+    segments_a, _ = frame(0)
+    segments_b, _ = frame(1)
+    pairs = np.array([[0, len(segments_b)]], dtype=np.int32)
+    with pytest.raises(IndexError):
+        compute_overlaps(segments_a, segments_b, pairs)
+
+
+def test_overlaps_of_constructed_segments():
+    # bbox origins at x != 0, so the masks are only aligned by their bbox
+    mask_a = np.ones((1, 2, 3), dtype=bool)
+    mask_b = np.zeros((1, 2, 2), dtype=bool)
+    mask_b[0, :, 1] = True
+    a = Segment(mask_a, np.array([0, 1, 4, 0, 2, 6], dtype=np.int32), 6, 0, 1)
+    b = Segment(mask_b, np.array([0, 1, 5, 0, 2, 6], dtype=np.int32), 2, 0, 1)
+
+    pairs, intersection, iou = compute_overlaps([a], [b])
+
+    assert a.x == 4
+    assert pairs.tolist() == [[0, 0]]
+    assert intersection.tolist() == [2]
+    np.testing.assert_allclose(iou, [2 / 6])
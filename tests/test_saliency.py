@@ -0,0 +1,87 @@
+import itertools
+
+import numpy as np
+import pytest
+
+from ultrack_td import compute_saliency_map
+
+
+def faces(foreground):
+    """Pairs of face-adjacent foreground voxels, as flat indices."""
+    index = np.arange(foreground.size).reshape(foreground.shape)
+    pairs = []
+    for axis in range(3):
+        lower = [slice(None)] * 3
+        upper = [slice(None)] * 3
+        lower[axis] = slice(None, -1)
+        upper[axis] = slice(1, None)
+        both = foreground[tuple(lower)] & foreground[tuple(upper)]
+        pairs += zip(index[tuple(lower)][both].tolist(), index[tuple(upper)][both].tolist())
+    return pairs
+
+
+def brute_force_saliency(foreground, contours, edge_weight):
+    """Largest minimax join level over the faces of every voxel."""
+    values = contours.ravel().astype(np.float64)
+    combine = (lambda a, b: (a + b) / 2) if edge_weight == "mean" else max
+    pairs = faces(foreground)
+    level = {p: combine(values[p[0]], values[p[1]]) for p in pairs}
+
+    # join level of a pair: the lowest level at which Kruskal connects it
+    parent = list(range(foreground.size))
+
+    def find(u):
+        while parent[u] != u:
+            parent[u] = parent[parent[u]]
+            u = parent[u]
+        return u
+
+    join = {}
+    members = {u: [u] for u in range(foreground.size)}
+    for (u, v), key in sorted(level.items(), key=lambda item: item[1]):
+        ru, rv = find(u), find(v)
+        if ru == rv:
+            continue
+        for a, b in itertools.product(members[ru], members[rv]):
+            join[(a, b)] = join[(b, a)] = key
+        parent[rv] = ru
+        members[ru] += members.pop(rv)
+
+    saliency = np.zeros(foreground.size)
+    for u, v in pairs:
+        saliency[u] = max(saliency[u], join[(u, v)])
+        saliency[v] = max(saliency[v], join[(u, v)])
+    return saliency.reshape(foreground.shape)
+
+
+@pytest.mark.parametrize("edge_weight", ["mean", "max"])
+def test_flood_saliency_matches_brute_force(edge_weight):
+    rng = np.random.default_rng(0)
+    contours = rng.random((3, 6, 7), dtype=np.float32)
+    foreground = contours < 0.85
+
+    saliency = compute_saliency_map(foreground, contours, edge_weight=edge_weight, engine="flood")
+
+    expected = brute_force_saliency(foreground, contours, edge_weight)
+    np.testing.assert_allclose(saliency, expected, rtol=1e-6)
+    assert (saliency[~foreground] == 0).all()
+
+
+def test_kruskal_saliency_bounds_flood():
+    # the kruskal engine joins over a spanning subgraph of the faces,
+    # so it never joins two sides below the level of all faces
+    rng = np.random.default_rng(1)
+    contours = rng.random((4, 8, 8), dtype=np.float32)
+    foreground = contours < 0.9
+
+    kruskal = compute_saliency_map(foreground, contours, engine="kruskal")
+    flood = compute_saliency_map(foreground, contours, engine="flood")
+
+    assert (kruskal >= flood).all()
+    assert (kruskal[~foreground] == 0).all()
+
+
+def test_saliency_rejects_other_engines():
+    contours = np.zeros((1, 2, 2), dtype=np.float32)
+    with pytest.raises(ValueError):
+        compute_saliency_map(contours > -1, contours, engine="basins")
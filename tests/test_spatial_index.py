@@ -0,0 +1,69 @@
+import numpy as np
+import pytest
+
+from ultrack_td import SpatialIndex, compute_segmentation_hypotheses
+
+
+def brute_force(points, queries, k, max_distance):
+    """(pairs, distances) of the k nearest points within max_distance of every query."""
+    pairs, distances = [], []
+    for q, query in enumerate(queries):
+        d = np.linalg.norm(points - query, axis=1)
+        order = np.argsort(d, kind="stable")
+        order = order[d[order] <= max_distance][:k]
+        pairs += [(q, int(i)) for i in order]
+        distances += d[order].tolist()
+    return np.array(pairs, dtype=np.int32).reshape(-1, 2), np.array(distances)
+
+
+@pytest.fixture
+def points():
+    return np.random.default_rng(0).uniform(0, 50, (300, 3)).astype(np.float32)
+
+
+@pytest.fixture
+def queries():
+    return np.random.default_rng(1).uniform(-5, 55, (80, 3)).astype(np.float32)
+
+
+@pytest.mark.parametrize("k, max_distance", [(1, np.inf), (5, np.inf), (10, 8.0), (400, np.inf)])
+def test_knn_matches_brute_force(points, queries, k, max_distance):
+    index = SpatialIndex.from_points(points)
+
+    pairs, distances = index.query_knn(queries, k, max_distance, num_threads=2)
+
+    expected_pairs, expected_distances = brute_force(points, queries, k, max_distance)
+    assert len(index) == len(points)
+    np.testing.assert_array_equal(pairs, expected_pairs)
+    np.testing.assert_allclose(distances, expected_distances, rtol=1e-5)
+
+
+@pytest.mark.parametrize("radius", [0.0, 4.0, 12.0])
+def test_radius_matches_brute_force(points, queries, radius):
+    index = SpatialIndex.from_points(points)
+
+    pairs, distances = index.query_radius(queries, radius)
+
+    expected_pairs, expected_distances = brute_force(points, queries, len(points), radius)
+    np.testing.assert_array_equal(pairs, expected_pairs)
+    np.testing.assert_allclose(distances, expected_distances, rtol=1e-5)
+
+
+def test_segments_are_indexed_by_centroid():
+    rng = np.random.default_rng(2)
+    contours = rng.random((3, 16, 16), dtype=np.float32)
+    segments = compute_segmentation_hypotheses(contours < 0.7, contours, 2, 30, 0)
+    centroids = np.array([s.centroid for s in segments], dtype=np.float32)
+
+    from_segments = SpatialIndex.from_segments(segments)
+    from_points = SpatialIndex.from_points(centroids)
+
+    for a, b in zip(from_segments.query_knn(segments, 3), from_points.query_knn(centroids, 3)):
+        np.testing.assert_array_equal(a, b)
+    for a, b in zip(from_segments.query_radius(segments, 2.5), from_points.query_radius(centroids, 2.5)):
+        np.testing.assert_array_equal(a, b)
+
+
+def test_knn_rejects_non_positive_k(points):
+    with pytest.raises(ValueError):
+        SpatialIndex.from_points(points).query_knn(points, 0)
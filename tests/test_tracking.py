@@ -0,0 +1,182 @@
+import itertools
+
+import numpy as np
+import pytest
+
+from ultrack_td import greedy_tracking, linear_assignment_tracking, min_cost_flow_tracking
+
+
+def random_graph(seed, num_frames=3, nodes_per_frame=3, num_links=7):
+    """Node frames and weights, within-frame conflicts and links from frame t to t + 1."""
+    rng = np.random.default_rng(seed)
+    times = np.repeat(np.arange(num_frames), nodes_per_frame).astype(np.int32)
+    node_weights = rng.uniform(-1, 1, len(times)).astype(np.float32)
+    conflicts = [
+        (i, j) for i, j in itertools.combinations(range(len(times)), 2)
+        if times[i] == times[j] and rng.random() < 0.3
+    ]
+    candidates = [
+        (i, j) for i, j in itertools.product(range(len(times)), repeat=2) if times[j] == times[i] + 1
+    ]
+    picked = rng.choice(len(candidates), num_links, replace=False)
+    links = np.array([candidates[k] for k in sorted(picked)], dtype=np.int32)
+    link_weights = rng.uniform(-1, 2, num_links).astype(np.float32)
+    return times, node_weights, np.array(conflicts, dtype=np.int32).reshape(-1, 2), links, link_weights
+
+
+def link_subsets(links, max_children):
+    """Every subset of links giving at most one parent per node and at most max_children children."""
+    for mask in itertools.product([False, True], repeat=len(links)):
+        chosen = links[np.array(mask, dtype=bool)]
+        if len(set(chosen[:, 1].tolist())) == len(chosen) and \
+                all(np.count_nonzero(chosen[:, 0] == s) <= max_children for s in chosen[:, 0]):
+            yield np.flatnonzero(mask)
+
+
+def children(links, selected, num_nodes):
+    return np.bincount(links[selected, 0], minlength=num_nodes)
+
+
+def greedy_objective(node_weights, links, link_weights, nodes, selected, division_weight):
+    num_children = children(links, selected, len(node_weights))
+    return (node_weights[nodes].sum() + link_weights[selected].sum() +
+            division_weight * np.maximum(num_children - 1, 0).sum())
+
+
+def greedy_optimum(node_weights, conflicts, links, link_weights, division_weight, max_children):
+    """Best objective over every feasible node and link selection."""
+    best = 0.0
+    for selected in link_subsets(links, max_children):
+        linked = set(links[selected].ravel().tolist())
+        free = [n for n in range(len(node_weights)) if n not in linked]
+        for extra in itertools.product([False, True], repeat=len(free)):
+            nodes = sorted(linked | {n for n, e in zip(free, extra) if e})
+            if any(a in nodes and b in nodes for a, b in conflicts.tolist()):
+                continue
+            best = max(best, greedy_objective(node_weights, links, link_weights, nodes, selected, division_weight))
+    return best
+
+
+@pytest.mark.parametrize("seed", range(8))
+@pytest.mark.parametrize("division_weight, max_children", [(0.0, 1), (-0.5, 2), (0.3, 2)])
+def test_greedy_is_feasible_and_bounded(seed, division_weight, max_children):
+    _, node_weights, conflicts, links, link_weights = random_graph(seed)
+
+    nodes, parents, selected = greedy_tracking(
+        node_weights, conflicts, links, link_weights, division_weight, max_children
+    )
+
+    chosen = set(nodes.tolist())
+    assert not any(a in chosen and b in chosen for a, b in conflicts.tolist())
+    assert set(links[selected].ravel().tolist()) <= chosen
+    expected_parents = np.full(len(node_weights), -1)
+    expected_parents[links[selected, 1]] = links[selected, 0]
+    np.testing.assert_array_equal(parents, expected_parents)
+    assert children(links, selected, len(node_weights)).max(initial=0) <= max_children
+
+    objective = greedy_objective(node_weights, links, link_weights, nodes, selected, division_weight)
+    optimum = greedy_optimum(node_weights, conflicts, links, link_weights, division_weight, max_children)
+    assert objective > 0 or len(nodes) == 0
+    assert objective <= optimum + 1e-5
+
+
+def test_greedy_requeues_rising_scores():
+    # A -> B makes A free for A -> C, whose score rises above D's,
+    # which conflicts with C
+    node_weights = np.array([-5.0, 0.0, 0.0, 0.9], dtype=np.float32)
+    conflicts = np.array([[2, 3]], dtype=np.int32)
+    links = np.array([[0, 1], [0, 2]], dtype=np.int32)
+    link_weights = np.array([6.0, 5.5], dtype=np.float32)
+
+    nodes, parents, selected = greedy_tracking(node_weights, conflicts, links, link_weights, 0.0, 2)
+
+    assert sorted(nodes.tolist()) == [0, 1, 2]
+    assert parents.tolist() == [-1, 0, 0, -1]
+    assert sorted(selected.tolist()) == [0, 1]
+    assert greedy_optimum(node_weights, conflicts, links, link_weights, 0.0, 2) == pytest.approx(6.5)
+
+
+def test_greedy_rejects_invalid_arguments():
+    node_weights = np.ones(2, dtype=np.float32)
+    no_conflicts = np.zeros((0, 2), dtype=np.int32)
+    with pytest.raises(IndexError):
+        greedy_tracking(node_weights, no_conflicts, np.array([[0, 2]], dtype=np.int32), np.ones(1, dtype=np.float32))
+    with pytest.raises(ValueError):
+        greedy_tracking(node_weights, no_conflicts, np.array([[0, 1]], dtype=np.int32), np.ones(2, dtype=np.float32))
+    with pytest.raises(ValueError):
+        greedy_tracking(node_weights, no_conflicts, np.array([[0, 1]], dtype=np.int32), np.ones(1, dtype=np.float32),
+                        max_children=0)
+
+
+def flow_objective(links, link_weights, selected, appear, disappear, division):
+    """Weight of a frame-to-frame association: every node of a link is kept."""
+    num_nodes = links.max() + 1
+    num_children = children(links, selected, num_nodes)
+    sources = np.unique(links[:, 0])
+    targets = np.unique(links[:, 1])
+    linked_targets = np.unique(links[selected, 1])
+    return (link_weights[selected].sum() + appear * (len(targets) - len(linked_targets)) +
+            disappear * np.count_nonzero(num_children[sources] == 0) +
+            division * np.maximum(num_children - 1, 0).sum())
+
+
+def check_parents(parents, links, selected, num_nodes):
+    expected = np.full(num_nodes, -1)
+    expected[links[selected, 1]] = links[selected, 0]
+    np.testing.assert_array_equal(parents, expected)
+
+
+# exact as long as a second child never pays more than the first saves,
+# i.e. division <= -disappear
+@pytest.mark.parametrize("seed", range(8))
+@pytest.mark.parametrize("appear, disappear, division, max_children", [
+    (0.0, 0.0, 0.0, 1), (-0.5, -0.3, 0.2, 2), (-1.0, 0.4, -0.6, 2), (0.0, 0.0, -1.0, 3),
+])
+def test_min_cost_flow_is_optimal(seed, appear, disappear, division, max_children):
+    times, _, _, links, link_weights = random_graph(seed)
+
+    parents, selected = min_cost_flow_tracking(
+        times, links, link_weights, appear, disappear, division, max_children, num_threads=2
+    )
+
+    check_parents(parents, links, selected, len(times))
+    assert children(links, selected, len(times)).max(initial=0) <= max_children
+    objective = flow_objective(links, link_weights, selected, appear, disappear, division)
+    optimum = max(
+        flow_objective(links, link_weights, subset, appear, disappear, division)
+        for subset in link_subsets(links, max_children)
+    )
+    assert objective == pytest.approx(optimum, abs=1e-4)
+
+
+def test_min_cost_flow_rejects_invalid_arguments():
+    times = np.array([0, 1, 1], dtype=np.int32)
+    links = np.array([[0, 1], [0, 2]], dtype=np.int32)
+    weights = np.ones(2, dtype=np.float32)
+    with pytest.raises(ValueError):
+        min_cost_flow_tracking(times, links, weights, max_children=0)
+    with pytest.raises(ValueError):
+        min_cost_flow_tracking(times, np.array([[1, 2]], dtype=np.int32), weights[:1])
+    # a second child paying more than the first saves makes costs non-convex
+    with pytest.raises(ValueError):
+        min_cost_flow_tracking(times, links, weights, disappear_weight=-0.5, division_weight=0.6)
+    parents, _ = min_cost_flow_tracking(times, links, weights, disappear_weight=-0.5, division_weight=0.6,
+                                        max_children=1)
+    assert parents.tolist() == [-1, 0, -1] or parents.tolist() == [-1, -1, 0]
+
+
+@pytest.mark.parametrize("seed", range(8))
+@pytest.mark.parametrize("appear, disappear", [(0.0, 0.0), (-0.5, -0.3), (0.6, -1.0)])
+def test_linear_assignment_is_optimal(seed, appear, disappear):
+    times, _, _, links, link_weights = random_graph(seed, nodes_per_frame=4, num_links=10)
+
+    parents, selected = linear_assignment_tracking(times, links, link_weights, appear, disappear, num_threads=2)
+
+    check_parents(parents, links, selected, len(times))
+    assert children(links, selected, len(times)).max(initial=0) <= 1
+    objective = flow_objective(links, link_weights, selected, appear, disappear, 0.0)
+    optimum = max(
+        flow_objective(links, link_weights, subset, appear, disappear, 0.0)
+        for subset in link_subsets(links, 1)
+    )
+    assert objective == pytest.approx(optimum, abs=1e-4)